@@ -0,0 +1,736 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "descent.h"
+#include "scalar.h"
+#include "shade.h"
+#include "timer.h"
+
+/*
+ * Headless render benchmark. Renders frames along scripted camera paths and
+ * reports the average time per frame spent in each RenderWorld stage.
+ * decks_ns includes building the per-frame row and column tables. With
+ * fused columns the decks are drawn inside the facing stage, so decks_ns
+ * only covers those tables. Stages overlap in the frame's job graph, so
+ * total_ns is the time of the whole RenderWorld rather than their sum, and
+ * --barriers runs the stages one after another to compare. wall_ns is the
+ * wall clock time per frame from the first frame's start to the last
+ * frame's end, so with --pipelined it falls below total_ns as simulation
+ * overlaps rendering. --no-glass clears the see-through walls, so comparing
+ * a run with and without it gives what layering them costs. --tex-length
+ * blows the textures up to that many texels a side, so larger art can be
+ * timed with the same maps, and --no-mips loads them without mips to
+ * compare. Cache misses come from the hardware counters where the kernel
+ * exposes them, and read n/a where it does not, as in most virtual
+ * machines. The usage line gives each worker's share of total_ns spent in
+ * jobs, what is left idle over all of them, and how far the slowest deck
+ * and facing job trail the fastest. The tail line gives percentiles of the
+ * per-frame total_ns and how long woken workers took to start a job.
+ * Run from build/ so the texture paths resolve like the game's.
+ */
+
+#define PI 3.14159265F
+#define OPEN_MAP_LENGTH 256
+#define OPEN_MAP_PILLAR_GAP 8
+
+typedef struct camera {
+    vec2 Pos;
+    vec2 Dir;
+} camera;
+
+typedef camera camera_path(float T);
+
+typedef struct bench_path {
+    const char *Name;
+    camera_path *Path;
+} bench_path;
+
+typedef enum cache_counter {
+    CC_L1D_READ,
+    CC_LAST_LEVEL,
+    CC_COUNT
+} cache_counter;
+
+typedef struct bench_result {
+    render_stats Sum;
+    worker_wait_stats Wait;
+    int64_t CacheMisses[CC_COUNT]; /*Negative when not counted*/
+    int64_t WallNS;
+    int64_t SceneWidthSum;
+    int64_t SceneHeightSum;
+    uint32_t Checksum;
+    int64_t *FrameNS; /*RenderNS of each presented frame, NULL if none*/
+    int32_t SampleCount;
+} bench_result;
+
+static vec2 DirFromAngle(float Angle) {
+    return (vec2) {cosf(Angle), sinf(Angle)};
+}
+
+/*Turn a full circle in the middle of the room*/
+static camera SpinPath(float T) {
+    return (camera) {
+        .Pos = {10.0F, 10.0F},
+        .Dir = DirFromAngle(2.0F * PI * T)
+    };
+}
+
+/*Walk the length of the room along the far wall*/
+static camera WalkPath(float T) {
+    return (camera) {
+        .Pos = {2.5F + 15.0F * T, 16.5F},
+        .Dir = DirFromAngle(0.25F * PI * sinf(2.0F * PI * T))
+    };
+}
+
+/*Strafe along the glass wall while facing it*/
+static camera GlassPath(float T) {
+    return (camera) {
+        .Pos = {8.5F, 4.5F + 10.0F * T},
+        .Dir = {-1.0F, 0.0F}
+    };
+}
+
+/*Circle the sprite cluster while facing its centre*/
+static camera SpritePath(float T) {
+    float Angle = 2.0F * PI * T;
+    return (camera) {
+        .Pos = {9.0F + 3.0F * cosf(Angle), 9.0F + 3.0F * sinf(Angle)},
+        .Dir = DirFromAngle(Angle + PI)
+    };
+}
+
+static game_state g_GameState;
+static int g_CacheCounters[CC_COUNT] = {-1, -1};
+
+/*
+ * Counts for the whole process from here on, threads started later
+ * included, so it is opened before the game state starts any. A counter
+ * that cannot be opened stays -1.
+ */
+static void OpenCacheCounters(void) {
+#ifdef __linux__
+    static const uint64_t s_Configs[CC_COUNT] = {
+        [CC_L1D_READ] = (
+            PERF_COUNT_HW_CACHE_L1D | 
+            PERF_COUNT_HW_CACHE_OP_READ << 8 | 
+            PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+        ),
+        [CC_LAST_LEVEL] = (
+            PERF_COUNT_HW_CACHE_LL | 
+            PERF_COUNT_HW_CACHE_OP_READ << 8 | 
+            PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+        )
+    };
+    for(int32_t I = 0; I < CC_COUNT; I++) {
+        struct perf_event_attr Attr = {
+            .type = PERF_TYPE_HW_CACHE,
+            .size = sizeof(Attr),
+            .config = s_Configs[I],
+            .inherit = 1,
+            .exclude_kernel = 1,
+            .exclude_hv = 1
+        };
+        g_CacheCounters[I] = syscall(SYS_perf_event_open, &Attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+static void CloseCacheCounters(void) {
+#ifdef __linux__
+    for(int32_t I = 0; I < CC_COUNT; I++) {
+        if(g_CacheCounters[I] >= 0) {
+            close(g_CacheCounters[I]);
+        }
+    }
+#endif
+}
+
+static void ReadCacheCounters(int64_t Counts[static CC_COUNT]) {
+    for(int32_t I = 0; I < CC_COUNT; I++) {
+        Counts[I] = -1;
+#ifdef __linux__
+        uint64_t Count;
+        bool IsRead = (
+            g_CacheCounters[I] >= 0 && 
+            read(g_CacheCounters[I], &Count, sizeof(Count)) == sizeof(Count)
+        );
+        if(IsRead) {
+            Counts[I] = (int64_t) Count;
+        }
+#endif
+    }
+}
+
+static const bench_path g_BenchPaths[] = {
+    {"spin", SpinPath},
+    {"walk", WalkPath},
+    {"glass", GlassPath},
+    {"sprite", SpritePath}
+};
+
+static uint32_t ChecksumPixels(const frame_buffer *Screen) {
+    uint32_t Hash = 2166136261U;
+    for(int32_t Y = 0; Y < Screen->Height; Y++) {
+        for(int32_t X = 0; X < Screen->Width; X++) {
+            /*Alpha never reaches the screen*/
+            uint32_t Raw = Screen->Pixels[Y * Screen->Width + X].Raw;
+            Raw &= 0x00FFFFFF;
+            Hash = (Hash ^ Raw) * 16777619U;
+        }
+    }
+    return Hash;
+}
+
+/*Scatters ghosts over the room from a fixed seed so runs compare*/
+static bool AddCrowd(game_state *GS, int32_t Count) {
+    uint32_t Seed = 12345U;
+    for(int32_t I = 0; I < Count; I++) {
+        float Coords[2];
+        for(int32_t J = 0; J < 2; J++) {
+            Seed = Seed * 1664525U + 1013904223U;
+            Coords[J] = 1.0F + 18.0F * (float) (Seed >> 8) / 16777216.0F;
+        }
+        sprite Ghost = {
+            .Pos = {Coords[0], Coords[1]},
+            .Tile = TD_GHOST
+        };
+        if(!AddSprite(GS, Ghost)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Swaps the room for a large sparse map of wood pillars, so rays cross
+ * long runs of empty cells. The paths stay clear of the pillars.
+ */
+static bool BuildOpenMap(game_state *GS) {
+    tile_map *Map = &GS->TileMap;
+    DestroyTileMap(Map);
+    if(!CreateTileMap(Map, OPEN_MAP_LENGTH, OPEN_MAP_LENGTH)) {
+        return false;
+    }
+    for(int32_t Y = 0; Y < OPEN_MAP_LENGTH; Y++) {
+        for(int32_t X = 0; X < OPEN_MAP_LENGTH; X++) {
+            int32_t Gap = OPEN_MAP_PILLAR_GAP;
+            if(X % Gap == Gap / 2 && Y % Gap == Gap / 2) {
+                SetTile(Map, X, Y, TD_WOOD);
+            }
+        }
+    }
+    UpdateEmptyRadii(Map);
+    return true;
+}
+
+/*Clears the see-through walls, so a path can be timed with and without*/
+static void RemoveGlass(game_state *GS) {
+    tile_map *Map = &GS->TileMap;
+    for(int32_t Y = 0; Y < Map->Height; Y++) {
+        for(int32_t X = 0; X < Map->Width; X++) {
+            if(GetTileData(GetTile(Map, X, Y)).Flags & TF_ALPHA) {
+                SetTile(Map, X, Y, TD_NONE);
+            }
+        }
+    }
+    UpdateEmptyRadii(Map);
+}
+
+/*Nearest-neighbour, so the art looks the same but samples like larger art*/
+static bool UpscaleTextures(game_state *GS, int32_t Length) {
+    int32_t Log2Length = __builtin_ctz(Length);
+    for(int32_t TexI = 1; TexI < TEX_COUNT; TexI++) {
+        texture *Src = &GS->Textures[TexI];
+        int32_t Shift = Log2Length - Src->Log2Length;
+        if(Shift <= 0) {
+            continue;
+        }
+        texture Dst;
+        if(!CreateTexture(&Dst, Log2Length, Src->MipCount > 1)) {
+            return false;
+        }
+        for(int32_t Y = 0; Y < Length; Y++) {
+            for(int32_t X = 0; X < Length; X++) {
+                uint32_t SrcI = GetTexelI(X >> Shift, Y >> Shift);
+                Dst.Texels[GetTexelI(X, Y)] = Src->Texels[SrcI];
+            }
+        }
+        BuildMips(&Dst);
+        DestroyTexture(Src);
+        *Src = Dst;
+    }
+
+    DestroyShadeCache(GS->Shades);
+    GS->Shades = CreateShadeCache(
+        GS->Config.ShadeLevels, 
+        TEX_COUNT, 
+        GS->Textures
+    );
+    return GS->Shades;
+}
+
+static void SetCamera(game_state *GS, camera Camera) {
+    GS->Pos = Camera.Pos;
+    GS->Dir = Camera.Dir;
+    GS->Plane = (vec2) {-0.5F * Camera.Dir.Y, 0.5F * Camera.Dir.X};
+}
+
+/*Pipelined frames are presented a call late, so count them as they land*/
+static void AddPresentedStats(
+    bench_result *Result, 
+    const game_state *GS, 
+    int64_t *PresentedCount
+) {
+    if(GS->PresentedCount == *PresentedCount) {
+        return;
+    }
+    *PresentedCount = GS->PresentedCount;
+
+    const render_stats *Stats = &GS->RenderStats;
+    Result->Sum.SortSpritesNS += Stats->SortSpritesNS;
+    Result->Sum.ComputeRenderSpriteInfosNS += (
+        Stats->ComputeRenderSpriteInfosNS
+    );
+    Result->Sum.RenderDecksNS += Stats->RenderDecksNS;
+    Result->Sum.RenderFacingNS += Stats->RenderFacingNS;
+    Result->Sum.UpscaleNS += Stats->UpscaleNS;
+    Result->Sum.RenderNS += Stats->RenderNS;
+    Result->Sum.DeckSpreadNS += Stats->DeckSpreadNS;
+    Result->Sum.FacingSpreadNS += Stats->FacingSpreadNS;
+    Result->Sum.WorkerCount = Stats->WorkerCount;
+
+    batch_usage *Usage = &Result->Sum.Usage;
+    for(int32_t I = 0; I < Stats->WorkerCount; I++) {
+        Usage->BusyNS[I] += Stats->Usage.BusyNS[I];
+    }
+    Usage->WakeCount += Stats->Usage.WakeCount;
+    Usage->WakeSumNS += Stats->Usage.WakeSumNS;
+    Usage->WakeMaxNS = MAX(Usage->WakeMaxNS, Stats->Usage.WakeMaxNS);
+    if(Result->FrameNS) {
+        Result->FrameNS[Result->SampleCount++] = Stats->RenderNS;
+    }
+    Result->SceneWidthSum += Stats->SceneWidth;
+    Result->SceneHeightSum += Stats->SceneHeight;
+}
+
+static bench_result RunPath(
+    game_state *GS,
+    const bench_path *Path,
+    int32_t FrameCount
+) {
+    bench_result Result = {
+        .FrameNS = malloc(FrameCount * sizeof(*Result.FrameNS))
+    };
+    int64_t MissesBefore[CC_COUNT];
+    ReadCacheCounters(MissesBefore);
+    worker_wait_stats WaitBefore = SumWorkerWaitStats(&GS->Pool);
+    int64_t PresentedCount = GS->PresentedCount;
+    int64_t StartNS = QueryTimeNS();
+    GS->TotalTime = 0.0F;
+    for(int32_t I = 0; I < FrameCount; I++) {
+        SetCamera(GS, Path->Path((float) I / (float) FrameCount));
+        GS->FrameDelta = 1.0F / 60.0F;
+        UpdateGameState(GS);
+        AddPresentedStats(&Result, GS, &PresentedCount);
+    }
+    FinishFrames(GS);
+    AddPresentedStats(&Result, GS, &PresentedCount);
+    Result.WallNS = QueryTimeNS() - StartNS;
+    int64_t MissesAfter[CC_COUNT];
+    ReadCacheCounters(MissesAfter);
+    for(int32_t I = 0; I < CC_COUNT; I++) {
+        bool IsCounted = MissesBefore[I] >= 0 && MissesAfter[I] >= 0;
+        Result.CacheMisses[I] = (
+            IsCounted ? MissesAfter[I] - MissesBefore[I] : -1
+        );
+    }
+    Result.Checksum = ChecksumPixels(&GS->Presented);
+
+    worker_wait_stats WaitAfter = SumWorkerWaitStats(&GS->Pool);
+    Result.Wait = (worker_wait_stats) {
+        .SpinNS = WaitAfter.SpinNS - WaitBefore.SpinNS,
+        .ParkNS = WaitAfter.ParkNS - WaitBefore.ParkNS,
+        .SpinWakes = WaitAfter.SpinWakes - WaitBefore.SpinWakes,
+        .ParkWakes = WaitAfter.ParkWakes - WaitBefore.ParkWakes
+    };
+    return Result;
+}
+
+static int CompareNS(const void *A, const void *B) {
+    int64_t NS_A = *(const int64_t *) A;
+    int64_t NS_B = *(const int64_t *) B;
+    return (NS_A > NS_B) - (NS_A < NS_B);
+}
+
+/*Samples must be sorted*/
+static int64_t GetPercentileNS(
+    int32_t Count, 
+    const int64_t Samples[static Count], 
+    int32_t Percent
+) {
+    return Samples[(int64_t) (Count - 1) * Percent / 100];
+}
+
+static void PrintUsageStats(const bench_result *Result) {
+    const render_stats *Sum = &Result->Sum;
+    const batch_usage *Usage = &Sum->Usage;
+    int64_t RenderNS = MAX(Sum->RenderNS, 1);
+    int64_t BusyNS = 0;
+    printf("%-8s busy%%", "  usage");
+    for(int32_t I = 0; I < Sum->WorkerCount; I++) {
+        printf(" %lld", (long long) (Usage->BusyNS[I] * 100 / RenderNS));
+        BusyNS += Usage->BusyNS[I];
+    }
+    int64_t WorkerNS = MAX(Sum->WorkerCount * RenderNS, 1);
+    int32_t SampleCount = MAX(Result->SampleCount, 1);
+    printf(
+        "  idle%% %lld  deck_spread_ns %lld  facing_spread_ns %lld\n",
+        (long long) (100 - BusyNS * 100 / WorkerNS),
+        (long long) (Sum->DeckSpreadNS / SampleCount),
+        (long long) (Sum->FacingSpreadNS / SampleCount)
+    );
+
+    printf("%-8s", "  tail");
+    if(Result->SampleCount > 0) {
+        int32_t Count = Result->SampleCount;
+        qsort(Result->FrameNS, Count, sizeof(*Result->FrameNS), CompareNS);
+        printf(
+            " frame_ns p50 %lld p99 %lld max %lld", 
+            (long long) GetPercentileNS(Count, Result->FrameNS, 50),
+            (long long) GetPercentileNS(Count, Result->FrameNS, 99),
+            (long long) Result->FrameNS[Count - 1]
+        );
+    } else {
+        printf(" frame_ns n/a");
+    }
+    printf(
+        "  wake_ns avg %lld max %lld\n",
+        (long long) (Usage->WakeSumNS / MAX(Usage->WakeCount, 1)),
+        (long long) Usage->WakeMaxNS
+    );
+}
+
+static void PrintResult(
+    const char *Name,
+    int32_t FrameCount,
+    const bench_result *Result
+) {
+    const render_stats *Sum = &Result->Sum;
+    printf(
+        "%-8s %7d %9lld %9lld %9lld %9lld %10lld %10lld %10lld  %08X\n",
+        Name,
+        FrameCount,
+        (long long) (Sum->SortSpritesNS / FrameCount),
+        (long long) (Sum->ComputeRenderSpriteInfosNS / FrameCount),
+        (long long) (Sum->RenderDecksNS / FrameCount),
+        (long long) (Sum->RenderFacingNS / FrameCount),
+        (long long) (Sum->UpscaleNS / FrameCount),
+        (long long) (Sum->RenderNS / FrameCount),
+        (long long) (Result->WallNS / FrameCount),
+        Result->Checksum
+    );
+
+    /*Summed over workers, so it can exceed the frame time*/
+    const worker_wait_stats *Wait = &Result->Wait;
+    printf(
+        "%-8s spin_ns %lld (%lld wakes)  park_ns %lld (%lld wakes)\n",
+        "  wait",
+        (long long) (Wait->SpinNS / FrameCount),
+        (long long) Wait->SpinWakes,
+        (long long) (Wait->ParkNS / FrameCount),
+        (long long) Wait->ParkWakes
+    );
+    printf(
+        "%-8s average %lldx%lld\n",
+        "  scene",
+        (long long) (Result->SceneWidthSum / FrameCount),
+        (long long) (Result->SceneHeightSum / FrameCount)
+    );
+    PrintUsageStats(Result);
+
+    /*Per frame, from the whole process rather than only the render stages*/
+    static const char *s_CounterNames[CC_COUNT] = {
+        [CC_L1D_READ] = "l1d_read_misses",
+        [CC_LAST_LEVEL] = "llc_read_misses"
+    };
+    printf("%-8s", "  cache");
+    for(int32_t I = 0; I < CC_COUNT; I++) {
+        if(Result->CacheMisses[I] < 0) {
+            printf(" %s n/a", s_CounterNames[I]);
+        } else {
+            printf(
+                " %s %lld", 
+                s_CounterNames[I], 
+                (long long) (Result->CacheMisses[I] / FrameCount)
+            );
+        }
+    }
+    printf("\n");
+}
+
+static void PrintUsage(void) {
+    fprintf(
+        stderr,
+        "usage: bench [--frames N] [--path spin|walk|glass|sprite]\n"
+        "             [--deck-kernel auto|scalar|sse2|avx2] [--workers N]\n"
+        "             [--columns split|fused] [--size WxH] [--budget-us N]\n"
+        "             [--sprites N] [--map room|open]\n"
+        "             [--ray-kernel auto|scalar|sse2|avx2] [--pipelined]\n"
+        "             [--shade-levels N] [--no-glass]\n"
+        "             [--layer-kernel auto|scalar|sse2|avx2]\n"
+        "             [--tex-length 16|32|...|1024] [--no-mips]\n"
+        "             [--barriers] [--pin]\n"
+    );
+}
+
+static bool ParseDeckKernel(const char *Name, deck_kernel *Kernel) {
+    static const char *s_Names[] = {
+        [DK_AUTO] = "auto",
+        [DK_SCALAR] = "scalar",
+        [DK_SSE2] = "sse2",
+        [DK_AVX2] = "avx2"
+    };
+    for(size_t I = 0; I < _countof(s_Names); I++) {
+        if(strcmp(Name, s_Names[I]) == 0) {
+            *Kernel = I;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseLayerKernel(const char *Name, layer_kernel *Kernel) {
+    static const char *s_Names[] = {
+        [LK_AUTO] = "auto",
+        [LK_SCALAR] = "scalar",
+        [LK_SSE2] = "sse2",
+        [LK_AVX2] = "avx2"
+    };
+    for(size_t I = 0; I < _countof(s_Names); I++) {
+        if(strcmp(Name, s_Names[I]) == 0) {
+            *Kernel = I;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseRayKernel(const char *Name, ray_kernel *Kernel) {
+    static const char *s_Names[] = {
+        [RK_AUTO] = "auto",
+        [RK_SCALAR] = "scalar",
+        [RK_SSE2] = "sse2",
+        [RK_AVX2] = "avx2"
+    };
+    for(size_t I = 0; I < _countof(s_Names); I++) {
+        if(strcmp(Name, s_Names[I]) == 0) {
+            *Kernel = I;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int ArgCount, char **Args) {
+    int32_t FrameCount = 600;
+    const char *PathName = NULL;
+    int32_t CrowdCount = 0;
+    bool IsOpenMap = false;
+    bool HasGlass = true;
+    int32_t TexLength = MIN_TEX_LENGTH;
+    render_config Config = {};
+
+    for(int I = 1; I < ArgCount; I++) {
+        const char *Arg = Args[I];
+        const char *Val = I + 1 < ArgCount ? Args[I + 1] : NULL;
+        if(strcmp(Arg, "--pipelined") == 0) {
+            Config.PipelinedFrames = true;
+            continue;
+        } else if(strcmp(Arg, "--barriers") == 0) {
+            Config.StageBarriers = true;
+            continue;
+        } else if(strcmp(Arg, "--pin") == 0) {
+            Config.PinWorkers = true;
+            continue;
+        } else if(strcmp(Arg, "--no-glass") == 0) {
+            HasGlass = false;
+            continue;
+        } else if(strcmp(Arg, "--no-mips") == 0) {
+            Config.NoMips = true;
+            continue;
+        } else if(Val && strcmp(Arg, "--frames") == 0) {
+            FrameCount = atoi(Val);
+        } else if(Val && strcmp(Arg, "--path") == 0) {
+            PathName = Val;
+        } else if(Val && strcmp(Arg, "--workers") == 0) {
+            Config.WorkerCount = atoi(Val);
+        } else if(Val && strcmp(Arg, "--size") == 0) {
+            if(sscanf(Val, "%dx%d", &Config.Width, &Config.Height) != 2) {
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        } else if(Val && strcmp(Arg, "--shade-levels") == 0) {
+            Config.ShadeLevels = atoi(Val);
+        } else if(Val && strcmp(Arg, "--tex-length") == 0) {
+            TexLength = atoi(Val);
+            if(
+                TexLength < MIN_TEX_LENGTH ||
+                TexLength > MAX_TEX_LENGTH ||
+                TexLength & (TexLength - 1)
+            ) {
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        } else if(Val && strcmp(Arg, "--sprites") == 0) {
+            CrowdCount = atoi(Val);
+        } else if(Val && strcmp(Arg, "--map") == 0) {
+            if(strcmp(Val, "open") == 0) {
+                IsOpenMap = true;
+            } else if(strcmp(Val, "room") != 0) {
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        } else if(Val && strcmp(Arg, "--budget-us") == 0) {
+            Config.FrameBudgetNS = atoll(Val) * 1000;
+        } else if(Val && strcmp(Arg, "--columns") == 0) {
+            if(strcmp(Val, "fused") == 0) {
+                Config.FusedColumns = true;
+            } else if(strcmp(Val, "split") != 0) {
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        } else if(
+            Val && 
+            strcmp(Arg, "--deck-kernel") == 0 && 
+            ParseDeckKernel(Val, &Config.DeckKernel)
+        ) {
+            if(!GetDeckSpanKernel(Config.DeckKernel)) {
+                fprintf(stderr, "bench: %s is not supported here\n", Val);
+                return EXIT_FAILURE;
+            }
+        } else if(
+            Val && 
+            strcmp(Arg, "--ray-kernel") == 0 && 
+            ParseRayKernel(Val, &Config.RayKernel)
+        ) {
+            if(!GetRayPacketKernel(Config.RayKernel)) {
+                fprintf(stderr, "bench: %s is not supported here\n", Val);
+                return EXIT_FAILURE;
+            }
+        } else if(
+            Val && 
+            strcmp(Arg, "--layer-kernel") == 0 && 
+            ParseLayerKernel(Val, &Config.LayerKernel)
+        ) {
+            if(!GetLayerRunKernel(Config.LayerKernel)) {
+                fprintf(stderr, "bench: %s is not supported here\n", Val);
+                return EXIT_FAILURE;
+            }
+        } else {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+        I++;
+    }
+    if(FrameCount <= 0) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    OpenCacheCounters();
+    game_state *GS = &g_GameState;
+    GS->Config = Config;
+    if(!CreateGameState(GS)) {
+        fprintf(
+            stderr, 
+            "bench: cannot create a %dx%d screen\n", 
+            Config.Width, 
+            Config.Height
+        );
+        return EXIT_FAILURE;
+    }
+    if(!AddCrowd(GS, CrowdCount)) {
+        fprintf(stderr, "bench: cannot add %d sprites\n", CrowdCount);
+        DestroyGameState(GS);
+        return EXIT_FAILURE;
+    }
+    if(IsOpenMap && !BuildOpenMap(GS)) {
+        fprintf(stderr, "bench: cannot create the open map\n");
+        DestroyGameState(GS);
+        return EXIT_FAILURE;
+    }
+    if(!HasGlass) {
+        RemoveGlass(GS);
+    }
+    if(TexLength > MIN_TEX_LENGTH && !UpscaleTextures(GS, TexLength)) {
+        fprintf(stderr, "bench: cannot create %dpx textures\n", TexLength);
+        DestroyGameState(GS);
+        return EXIT_FAILURE;
+    }
+    printf(
+        "workers: %d%s  columns: %s  frames: %s  stages: %s  "
+        "screen: %dx%d  "
+        "sprites: %u  map: %dx%d  glass: %s  shade levels: %d  "
+        "textures: %dpx  mips: %s\n", 
+        GS->Pool.WorkerCount, 
+        Config.PinWorkers ? " pinned" : "",
+        Config.FusedColumns ? "fused" : "split",
+        GS->Config.PipelinedFrames ? "pipelined" : "serial",
+        Config.StageBarriers ? "barriers" : "graph",
+        GS->Screen.Width,
+        GS->Screen.Height,
+        GS->SpriteCount,
+        GS->TileMap.Width,
+        GS->TileMap.Height,
+        HasGlass ? "on" : "off",
+        GS->Shades->LevelCount,
+        TexLength,
+        Config.NoMips ? "off" : "on"
+    );
+
+    printf(
+        "%-8s %7s %9s %9s %9s %9s %10s %10s %10s  %s\n",
+        "path",
+        "frames",
+        "sort_ns",
+        "infos_ns",
+        "decks_ns",
+        "facing_ns",
+        "upscale_ns",
+        "total_ns",
+        "wall_ns",
+        "checksum"
+    );
+
+    bool FoundPath = false;
+    for(size_t I = 0; I < _countof(g_BenchPaths); I++) {
+        const bench_path *Path = &g_BenchPaths[I];
+        if(PathName && strcmp(PathName, Path->Name) != 0) {
+            continue;
+        }
+        FoundPath = true;
+
+        bench_result Result = RunPath(GS, Path, FrameCount);
+        PrintResult(Path->Name, FrameCount, &Result);
+        free(Result.FrameNS);
+    }
+
+    DestroyGameState(GS);
+    CloseCacheCounters();
+
+    if(!FoundPath) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,13 +1,22 @@
 import os
 from collections import OrderedDict
 
+# Sources only linked into the headless bench
+bench_only = {'bench.c', 'worker_posix.c'}
+# Portable core shared by the game and the bench
+bench_core = {
+    'deck.c', 'descent.c', 'layer.c', 'ray_packet.c', 'render.c',
+    'render_tables.c', 'scaler.c', 'shade.c', 'texture.c', 'tile_data.c',
+    'tile_map.c', 'transpose.c', 'upscale.c', 'worker.c'
+}
+
 source_dict = {}
 header_dict = {}
 flat_dict = {}
 object_dict = OrderedDict()
 
 def recurse(func):
-    dir_list = os.listdir('.')
+    dir_list = sorted(os.listdir('.'))
     for name in dir_list:
         if os.path.isdir(name):
             os.chdir(name)
@@ -38,10 +47,16 @@ def extract_libs_from(path):
         header_dict[path] = extract_all_libs(path)
 
 def create_flat_dict():
+    # Follow includes transitively so nested header changes rebuild
     for k, v in source_dict.items():
-        flat_dict[k] = v 
-        for e in v:
-            flat_dict[k] = flat_dict[k].union(header_dict[e])
+        flat_dict[k] = set(v)
+        pending = list(v)
+        while pending:
+            e = pending.pop()
+            for d in header_dict.get(e, ()):
+                if d not in flat_dict[k]:
+                    flat_dict[k].add(d)
+                    pending.append(d)
     return flat_dict
 
 def comp(source_path):
@@ -51,6 +66,8 @@ def comp(source_path):
 
 def build():
     for source_path, header_paths in flat_dict.items():
+        if source_path in bench_only:
+            continue
         object_path = source_path.replace('.c', '.o')
         source_modify = os.path.getmtime(source_path) 
         try:
@@ -73,14 +90,27 @@ def create_object_dict():
         object_path = source_path.replace('.c', '.o')
         object_dict[object_path] = {source_path}.union(flat_dict[source_path])
 
+def to_objects(source_paths):
+    return [
+        object_path 
+        for object_path in object_dict.keys() 
+        if object_path.replace('.o', '.c') in source_paths
+    ]
+
 def create_makefile():
+    game_objects = to_objects(source_dict.keys() - bench_only)
+    bench_objects = to_objects(bench_core | bench_only)
     with open('makefile', 'w') as f:
         f.write('') 
         f.write('CPPFLAGS = -Wall -g -O3\n')
-        f.write('OBJFILES = ' + ' '.join(object_dict.keys()) + '\n')
-        f.write('LINKFLAGS = -mconsole -mwindows\n\n')
+        f.write('OBJFILES = ' + ' '.join(game_objects) + '\n')
+        f.write('BENCHFILES = ' + ' '.join(bench_objects) + '\n')
+        f.write('LINKFLAGS = -mconsole -mwindows\n')
+        f.write('BENCHLINKFLAGS = -lm -lpthread\n\n')
         f.write('output: $(OBJFILES)\n')
         f.write('\tgcc $(OBJFILES) -o ../build/descent $(LINKFLAGS)\n')
+        f.write('\nbench: $(BENCHFILES)\n')
+        f.write('\tgcc $(BENCHFILES) -o ../build/bench $(BENCHLINKFLAGS)\n')
         for object_path in object_dict.keys():
             source_path = object_path.replace('.o', '.c')
             header_paths = list(flat_dict[source_path])
@@ -2,6 +2,12 @@
 #define COLOR_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COLOR_X86
+#include <immintrin.h>
+#endif
 
 typedef union color {
     uint32_t Raw;
@@ -18,15 +24,25 @@ static inline color OpaqueColor(uint8_t Red, uint8_t Green, uint8_t Blue) {
 }
 
 static inline bool IsOpaque(color Color) {
-    return Color.Alpha == 255; 
+    return Color.Alpha == 255;
+}
+
+/*
+ * Scales are 8-bit, with 255 meaning unchanged. They widen to a factor in
+ * [0, 256] so every channel scales with one multiply and one shift.
+ */
+static inline uint32_t ScaleFactor(uint8_t Scale) {
+    return Scale + (Scale >> 7);
 }
 
-static inline color MulColor(color Color, float Mul) {
+/*Scales RGB and keeps alpha*/
+static inline color ScaleColor(color Color, uint8_t Scale) {
+    uint32_t Factor = ScaleFactor(Scale);
     return (color) {
-        .Red = Color.Red * Mul,
-        .Green = Color.Green * Mul,
-        .Blue = Color.Blue * Mul,
-        .Alpha = Color.Alpha 
+        .Red = Color.Red * Factor >> 8,
+        .Green = Color.Green * Factor >> 8,
+        .Blue = Color.Blue * Factor >> 8,
+        .Alpha = Color.Alpha
     };
 }
 
@@ -38,15 +54,148 @@ static inline color AddColor(color Left, color Right) {
     return (color) {
         .Red = Left.Red + Right.Red,
         .Green = Left.Green + Right.Green,
-        .Blue = Left.Blue + Right.Blue, 
+        .Blue = Left.Blue + Right.Blue,
         .Alpha = Left.Alpha + Right.Alpha
     };
 }
 
+static inline uint8_t SatAddChannel(uint8_t Left, uint8_t Right) {
+    uint32_t Sum = (uint32_t) Left + Right;
+    return Sum < 255 ? Sum : 255;
+}
+
+static inline color SatAddColor(color Left, color Right) {
+    return (color) {
+        .Red = SatAddChannel(Left.Red, Right.Red),
+        .Green = SatAddChannel(Left.Green, Right.Green),
+        .Blue = SatAddChannel(Left.Blue, Right.Blue),
+        .Alpha = SatAddChannel(Left.Alpha, Right.Alpha)
+    };
+}
+
+static inline uint8_t LayerChannel(uint8_t AddTo, uint8_t ToAdd, uint32_t F) {
+    return (AddTo * (256 - F) + ToAdd * F) >> 8;
+}
+
+/*Alpha-over of ToAdd onto AddTo using the alpha of ToAdd*/
 static inline color LayerColor(color AddTo, color ToAdd) {
-    color Left = (MulColor(AddTo, 1.0F - (ToAdd.Alpha) / 255.0F));
-    color Right = MulColor(ToAdd, ToAdd.Alpha / 255.0F);
-    return AddColor(Left, Right);
+    uint32_t F = ScaleFactor(ToAdd.Alpha);
+    return (color) {
+        .Red = LayerChannel(AddTo.Red, ToAdd.Red, F),
+        .Green = LayerChannel(AddTo.Green, ToAdd.Green, F),
+        .Blue = LayerChannel(AddTo.Blue, ToAdd.Blue, F),
+        .Alpha = LayerChannel(AddTo.Alpha, ToAdd.Alpha, F)
+    };
+}
+
+/*
+ * Packed variants work on four (SSE2) or eight (AVX2) colors at once and
+ * give the same results as the scalar helpers above.
+ */
+#ifdef __SSE2__
+
+typedef __m128i color4;
+
+static inline color4 HalfColor4(color4 Colors) {
+    return _mm_and_si128(
+        _mm_srli_epi32(Colors, 1),
+        _mm_set1_epi32(0x007F7F7F)
+    );
+}
+
+static inline color4 SatAddColor4(color4 Left, color4 Right) {
+    return _mm_adds_epu8(Left, Right);
+}
+
+/*Broadcasts each pixel's alpha to its four 16-bit channels*/
+static inline __m128i LayerFactor4(__m128i Channels) {
+    __m128i Alpha = _mm_shufflehi_epi16(
+        _mm_shufflelo_epi16(Channels, _MM_SHUFFLE(3, 3, 3, 3)),
+        _MM_SHUFFLE(3, 3, 3, 3)
+    );
+    return _mm_add_epi16(Alpha, _mm_srli_epi16(Alpha, 7));
 }
 
+static inline __m128i LayerChannels4(__m128i AddTo, __m128i ToAdd) {
+    __m128i F = LayerFactor4(ToAdd);
+    __m128i InvF = _mm_sub_epi16(_mm_set1_epi16(256), F);
+    return _mm_srli_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(AddTo, InvF), _mm_mullo_epi16(ToAdd, F)),
+        8
+    );
+}
+
+static inline color4 LayerColor4(color4 AddTo, color4 ToAdd) {
+    __m128i Zero = _mm_setzero_si128();
+    __m128i Lo = LayerChannels4(
+        _mm_unpacklo_epi8(AddTo, Zero),
+        _mm_unpacklo_epi8(ToAdd, Zero)
+    );
+    __m128i Hi = LayerChannels4(
+        _mm_unpackhi_epi8(AddTo, Zero),
+        _mm_unpackhi_epi8(ToAdd, Zero)
+    );
+    return _mm_packus_epi16(Lo, Hi);
+}
+
+#endif
+
+static inline bool HasAVX2(void) {
+#ifdef COLOR_X86
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+#ifdef COLOR_X86
+
+typedef __m256i color8;
+
+__attribute__((target("avx2")))
+static inline color8 HalfColor8(color8 Colors) {
+    return _mm256_and_si256(
+        _mm256_srli_epi32(Colors, 1),
+        _mm256_set1_epi32(0x007F7F7F)
+    );
+}
+
+__attribute__((target("avx2")))
+static inline color8 SatAddColor8(color8 Left, color8 Right) {
+    return _mm256_adds_epu8(Left, Right);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i LayerChannels8(__m256i AddTo, __m256i ToAdd) {
+    __m256i Alpha = _mm256_shufflehi_epi16(
+        _mm256_shufflelo_epi16(ToAdd, _MM_SHUFFLE(3, 3, 3, 3)),
+        _MM_SHUFFLE(3, 3, 3, 3)
+    );
+    __m256i F = _mm256_add_epi16(Alpha, _mm256_srli_epi16(Alpha, 7));
+    __m256i InvF = _mm256_sub_epi16(_mm256_set1_epi16(256), F);
+    return _mm256_srli_epi16(
+        _mm256_add_epi16(
+            _mm256_mullo_epi16(AddTo, InvF),
+            _mm256_mullo_epi16(ToAdd, F)
+        ),
+        8
+    );
+}
+
+__attribute__((target("avx2")))
+static inline color8 LayerColor8(color8 AddTo, color8 ToAdd) {
+    __m256i Zero = _mm256_setzero_si256();
+    __m256i Lo = LayerChannels8(
+        _mm256_unpacklo_epi8(AddTo, Zero),
+        _mm256_unpacklo_epi8(ToAdd, Zero)
+    );
+    __m256i Hi = LayerChannels8(
+        _mm256_unpackhi_epi8(AddTo, Zero),
+        _mm256_unpackhi_epi8(ToAdd, Zero)
+    );
+    return _mm256_packus_epi16(Lo, Hi);
+}
+
+#endif
+
 #endif
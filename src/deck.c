@@ -0,0 +1,341 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "deck.h"
+#include "descent.h"
+
+/*
+ * The top Log2Length bits of each 0.32 fraction are the texel coordinates,
+ * so Shift is 32 less it. A one texel mip shifts by all 32.
+ */
+static inline uint32_t DeckTexI(uint32_t U, uint32_t V, uint32_t Shift) {
+    return GetTexelI((uint64_t) U >> Shift, (uint64_t) V >> Shift);
+}
+
+static void RenderDeckSpanScalar(const deck_span *Span) {
+    uint32_t FloorShift = 32 - Span->FloorTex.Log2Length;
+    uint32_t CeilShift = 32 - Span->CeilTex.Log2Length;
+    bool IsSameSize = FloorShift == CeilShift;
+    uint32_t U = Span->U;
+    uint32_t V = Span->V;
+    for(int32_t X = 0; X < Span->Count; X++) {
+        uint32_t FloorI = DeckTexI(U, V, FloorShift);
+        uint32_t CeilI = IsSameSize ? FloorI : DeckTexI(U, V, CeilShift);
+        U += Span->StepU;
+        V += Span->StepV;
+
+        Span->FloorRow[X] = Span->FloorTex.Texels[FloorI];
+        Span->CeilRow[X] = Span->CeilTex.Texels[CeilI];
+    }
+}
+
+/*Coordinates step exactly as in the span kernels, so both agree per pixel*/
+static void RenderDeckColumnScalar(const deck_column *Column) {
+    uint32_t X = Column->X;
+    for(int32_t Y = Column->Start; Y < Column->End; Y++) {
+        uint32_t TexI = DeckTexI(
+            Column->RowU[Y] + X * Column->RowStepU[Y],
+            Column->RowV[Y] + X * Column->RowStepV[Y],
+            Column->RowShift[Y]
+        );
+        Column->Pixels[Y] = Column->Tex.Texels[Column->RowShade[Y] + TexI];
+    }
+}
+
+/*
+ * Tail pixels past the last full vector go through the scalar kernel with
+ * the coordinates advanced to where the vector loop stopped.
+ */
+static void RenderDeckSpanTail(const deck_span *Span, int32_t X) {
+    deck_span Tail = *Span;
+    Tail.FloorRow += X;
+    Tail.CeilRow += X;
+    Tail.Count -= X;
+    Tail.U += (uint32_t) X * Span->StepU;
+    Tail.V += (uint32_t) X * Span->StepV;
+    RenderDeckSpanScalar(&Tail);
+}
+
+/*
+ * The vector kernels are written once for a constant Bits, the most any
+ * texel coordinate has, so each size class gets a loop that spreads only
+ * the bits it needs. Spans where floor and ceiling are the same size, no
+ * bigger than the smallest texture, take MIN_TEX_LOG2 and share one index
+ * between them; that covers all of the stock art and its mips. Everything
+ * else takes MAX_TEX_LOG2.
+ */
+[[maybe_unused]]
+static inline int32_t GetDeckSpanBits(const deck_span *Span) {
+    int32_t FloorLog2 = Span->FloorTex.Log2Length;
+    bool IsSmall = (
+        FloorLog2 == Span->CeilTex.Log2Length && 
+        FloorLog2 <= MIN_TEX_LOG2
+    );
+    return IsSmall ? MIN_TEX_LOG2 : MAX_TEX_LOG2;
+}
+
+#ifdef __SSE2__
+
+static inline __m128i GatherDeckSSE2(const color *Tex, __m128i TexI) {
+    int32_t I[4];
+    _mm_storeu_si128((__m128i *) I, TexI);
+    return _mm_set_epi32(
+        Tex[I[3]].Raw,
+        Tex[I[2]].Raw,
+        Tex[I[1]].Raw,
+        Tex[I[0]].Raw
+    );
+}
+
+static inline __m128i DeckTexISSE2(
+    __m128i U, 
+    __m128i V, 
+    __m128i Shift, 
+    int32_t Bits
+) {
+    return GetTexelI4(_mm_srl_epi32(U, Shift), _mm_srl_epi32(V, Shift), Bits);
+}
+
+/*Eight pixels per iteration as two four-lane halves*/
+static inline void RenderDeckSpanSizedSSE2(
+    const deck_span *Span, 
+    int32_t Bits
+) {
+    uint32_t StepU = Span->StepU;
+    uint32_t StepV = Span->StepV;
+    __m128i U = _mm_set_epi32(
+        Span->U + 3 * StepU,
+        Span->U + 2 * StepU,
+        Span->U + StepU,
+        Span->U
+    );
+    __m128i V = _mm_set_epi32(
+        Span->V + 3 * StepV,
+        Span->V + 2 * StepV,
+        Span->V + StepV,
+        Span->V
+    );
+    __m128i StepU4 = _mm_set1_epi32(4 * StepU);
+    __m128i StepV4 = _mm_set1_epi32(4 * StepV);
+    __m128i FloorShift = _mm_cvtsi32_si128(32 - Span->FloorTex.Log2Length);
+    __m128i CeilShift = _mm_cvtsi32_si128(32 - Span->CeilTex.Log2Length);
+    bool IsSameSize = Bits == MIN_TEX_LOG2;
+
+    int32_t X = 0;
+    for(; X + 8 <= Span->Count; X += 8) {
+        __m128i FloorI0 = DeckTexISSE2(U, V, FloorShift, Bits);
+        __m128i CeilI0 = (
+            IsSameSize ? FloorI0 : DeckTexISSE2(U, V, CeilShift, Bits)
+        );
+        U = _mm_add_epi32(U, StepU4);
+        V = _mm_add_epi32(V, StepV4);
+        __m128i FloorI1 = DeckTexISSE2(U, V, FloorShift, Bits);
+        __m128i CeilI1 = (
+            IsSameSize ? FloorI1 : DeckTexISSE2(U, V, CeilShift, Bits)
+        );
+        U = _mm_add_epi32(U, StepU4);
+        V = _mm_add_epi32(V, StepV4);
+
+        __m128i Floor0 = GatherDeckSSE2(Span->FloorTex.Texels, FloorI0);
+        __m128i Floor1 = GatherDeckSSE2(Span->FloorTex.Texels, FloorI1);
+        __m128i Ceil0 = GatherDeckSSE2(Span->CeilTex.Texels, CeilI0);
+        __m128i Ceil1 = GatherDeckSSE2(Span->CeilTex.Texels, CeilI1);
+
+        __m128i *FloorOut = (__m128i *) &Span->FloorRow[X];
+        __m128i *CeilOut = (__m128i *) &Span->CeilRow[X];
+        _mm_storeu_si128(FloorOut, Floor0);
+        _mm_storeu_si128(FloorOut + 1, Floor1);
+        _mm_storeu_si128(CeilOut, Ceil0);
+        _mm_storeu_si128(CeilOut + 1, Ceil1);
+    }
+    RenderDeckSpanTail(Span, X);
+}
+
+static void RenderDeckSpanSSE2(const deck_span *Span) {
+    if(GetDeckSpanBits(Span) == MIN_TEX_LOG2) {
+        RenderDeckSpanSizedSSE2(Span, MIN_TEX_LOG2);
+    } else {
+        RenderDeckSpanSizedSSE2(Span, MAX_TEX_LOG2);
+    }
+}
+
+#endif
+
+#ifdef COLOR_X86
+
+__attribute__((target("avx2")))
+static inline __m256i DeckTexIAVX2(
+    __m256i U, 
+    __m256i V, 
+    __m128i Shift, 
+    int32_t Bits
+) {
+    return GetTexelI8(
+        _mm256_srl_epi32(U, Shift),
+        _mm256_srl_epi32(V, Shift),
+        Bits
+    );
+}
+
+/*Sixteen pixels per iteration as two eight-lane halves*/
+__attribute__((target("avx2")))
+static inline void RenderDeckSpanSizedAVX2(
+    const deck_span *Span, 
+    int32_t Bits
+) {
+    __m256i Lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i U = _mm256_add_epi32(
+        _mm256_set1_epi32(Span->U),
+        _mm256_mullo_epi32(Lanes, _mm256_set1_epi32(Span->StepU))
+    );
+    __m256i V = _mm256_add_epi32(
+        _mm256_set1_epi32(Span->V),
+        _mm256_mullo_epi32(Lanes, _mm256_set1_epi32(Span->StepV))
+    );
+    __m256i StepU8 = _mm256_set1_epi32(8 * Span->StepU);
+    __m256i StepV8 = _mm256_set1_epi32(8 * Span->StepV);
+    __m128i FloorShift = _mm_cvtsi32_si128(32 - Span->FloorTex.Log2Length);
+    __m128i CeilShift = _mm_cvtsi32_si128(32 - Span->CeilTex.Log2Length);
+    bool IsSameSize = Bits == MIN_TEX_LOG2;
+    const int *FloorTex = (const int *) Span->FloorTex.Texels;
+    const int *CeilTex = (const int *) Span->CeilTex.Texels;
+
+    int32_t X = 0;
+    for(; X + 16 <= Span->Count; X += 16) {
+        __m256i FloorI0 = DeckTexIAVX2(U, V, FloorShift, Bits);
+        __m256i CeilI0 = (
+            IsSameSize ? FloorI0 : DeckTexIAVX2(U, V, CeilShift, Bits)
+        );
+        U = _mm256_add_epi32(U, StepU8);
+        V = _mm256_add_epi32(V, StepV8);
+        __m256i FloorI1 = DeckTexIAVX2(U, V, FloorShift, Bits);
+        __m256i CeilI1 = (
+            IsSameSize ? FloorI1 : DeckTexIAVX2(U, V, CeilShift, Bits)
+        );
+        U = _mm256_add_epi32(U, StepU8);
+        V = _mm256_add_epi32(V, StepV8);
+
+        __m256i Floor0 = _mm256_i32gather_epi32(FloorTex, FloorI0, 4);
+        __m256i Floor1 = _mm256_i32gather_epi32(FloorTex, FloorI1, 4);
+        __m256i Ceil0 = _mm256_i32gather_epi32(CeilTex, CeilI0, 4);
+        __m256i Ceil1 = _mm256_i32gather_epi32(CeilTex, CeilI1, 4);
+
+        __m256i *FloorOut = (__m256i *) &Span->FloorRow[X];
+        __m256i *CeilOut = (__m256i *) &Span->CeilRow[X];
+        _mm256_storeu_si256(FloorOut, Floor0);
+        _mm256_storeu_si256(FloorOut + 1, Floor1);
+        _mm256_storeu_si256(CeilOut, Ceil0);
+        _mm256_storeu_si256(CeilOut + 1, Ceil1);
+    }
+    RenderDeckSpanTail(Span, X);
+}
+
+__attribute__((target("avx2")))
+static void RenderDeckSpanAVX2(const deck_span *Span) {
+    if(GetDeckSpanBits(Span) == MIN_TEX_LOG2) {
+        RenderDeckSpanSizedAVX2(Span, MIN_TEX_LOG2);
+    } else {
+        RenderDeckSpanSizedAVX2(Span, MAX_TEX_LOG2);
+    }
+}
+
+/*Eight rows per iteration, each with its own coordinates, shade and mip*/
+__attribute__((target("avx2")))
+static inline void RenderDeckColumnSizedAVX2(
+    const deck_column *Column, 
+    int32_t Bits
+) {
+    __m256i X = _mm256_set1_epi32(Column->X);
+    const int *Tex = (const int *) Column->Tex.Texels;
+
+    int32_t Y = Column->Start;
+    for(; Y + 8 <= Column->End; Y += 8) {
+        __m256i U = _mm256_loadu_si256((const __m256i *) &Column->RowU[Y]);
+        __m256i V = _mm256_loadu_si256((const __m256i *) &Column->RowV[Y]);
+        __m256i StepU = _mm256_loadu_si256(
+            (const __m256i *) &Column->RowStepU[Y]
+        );
+        __m256i StepV = _mm256_loadu_si256(
+            (const __m256i *) &Column->RowStepV[Y]
+        );
+        __m256i Shade = _mm256_loadu_si256(
+            (const __m256i *) &Column->RowShade[Y]
+        );
+        __m256i Shift = _mm256_loadu_si256(
+            (const __m256i *) &Column->RowShift[Y]
+        );
+
+        U = _mm256_add_epi32(U, _mm256_mullo_epi32(X, StepU));
+        V = _mm256_add_epi32(V, _mm256_mullo_epi32(X, StepV));
+        __m256i MipI = GetTexelI8(
+            _mm256_srlv_epi32(U, Shift),
+            _mm256_srlv_epi32(V, Shift),
+            Bits
+        );
+        __m256i TexI = _mm256_add_epi32(Shade, MipI);
+        _mm256_storeu_si256(
+            (__m256i *) &Column->Pixels[Y], 
+            _mm256_i32gather_epi32(Tex, TexI, 4)
+        );
+    }
+
+    deck_column Tail = *Column;
+    Tail.Start = Y;
+    RenderDeckColumnScalar(&Tail);
+}
+
+__attribute__((target("avx2")))
+static void RenderDeckColumnAVX2(const deck_column *Column) {
+    /*MipsAreNeverBiggerThanTheFullSize*/
+    if(Column->Tex.Log2Length <= MIN_TEX_LOG2) {
+        RenderDeckColumnSizedAVX2(Column, MIN_TEX_LOG2);
+    } else {
+        RenderDeckColumnSizedAVX2(Column, MAX_TEX_LOG2);
+    }
+}
+
+#endif
+
+/*Returns NULL when the requested kernel is not available on this CPU*/
+deck_span_kernel *GetDeckSpanKernel(deck_kernel Kernel) {
+    switch(Kernel) {
+    case DK_AUTO:
+        if(HasAVX2()) {
+            return GetDeckSpanKernel(DK_AVX2);
+        }
+        return GetDeckSpanKernel(DK_SSE2) ?: RenderDeckSpanScalar;
+    case DK_SCALAR:
+        return RenderDeckSpanScalar;
+    case DK_SSE2:
+#ifdef __SSE2__
+        return RenderDeckSpanSSE2;
+#else
+        return NULL;
+#endif
+    case DK_AVX2:
+#ifdef COLOR_X86
+        return HasAVX2() ? RenderDeckSpanAVX2 : NULL;
+#else
+        return NULL;
+#endif
+    }
+    return NULL;
+}
+
+/*Columns have no SSE2 kernel, the gathers dominate without AVX2*/
+deck_column_kernel *GetDeckColumnKernel(deck_kernel Kernel) {
+    switch(Kernel) {
+    case DK_AUTO:
+        return GetDeckColumnKernel(DK_AVX2) ?: RenderDeckColumnScalar;
+    case DK_SCALAR:
+    case DK_SSE2:
+        return RenderDeckColumnScalar;
+    case DK_AVX2:
+#ifdef COLOR_X86
+        return HasAVX2() ? RenderDeckColumnAVX2 : NULL;
+#else
+        return NULL;
+#endif
+    }
+    return NULL;
+}
@@ -0,0 +1,72 @@
+#ifndef DECK_H
+#define DECK_H
+
+#include <stdint.h>
+
+#include "color.h"
+#include "texture.h"
+
+typedef enum deck_kernel {
+    DK_AUTO,
+    DK_SCALAR,
+    DK_SSE2,
+    DK_AVX2
+} deck_kernel;
+
+/*
+ * One row of floor and its mirrored ceiling row. Texture coordinates are
+ * 0.32 fixed-point fractions that wrap on overflow, so only the position
+ * within the current tile is kept, and the top bits pick the texel at any
+ * texture size. The textures are the pre-shaded copies at each row's fog,
+ * so texels are stored as fetched.
+ */
+typedef struct deck_span {
+    texture FloorTex;
+    texture CeilTex;
+    color *FloorRow;
+    color *CeilRow;
+    int32_t Count;
+
+    uint32_t U;
+    uint32_t V;
+    uint32_t StepU;
+    uint32_t StepV;
+} deck_span;
+
+typedef void deck_span_kernel(const deck_span *Span);
+
+/*
+ * A run of one deck in a column-major screen column. The row table is
+ * indexed by screen row and kept as separate arrays so a column loads
+ * several rows at once; ceiling rows repeat their mirrored floor row with
+ * the ceiling fog. Each row reads its texels RowShade[Row] past Tex, which
+ * moves to the pre-shaded copy at that row's fog and to the row's mip.
+ * RowShift is 32 less that mip's Log2Length, which takes the row's
+ * coordinates to its texels.
+ */
+typedef struct deck_column {
+    texture Tex;
+    const uint32_t *RowU;
+    const uint32_t *RowV;
+    const uint32_t *RowStepU;
+    const uint32_t *RowStepV;
+    const uint32_t *RowShade;
+    const uint32_t *RowShift;
+
+    color *Pixels;
+    uint32_t X;
+    int32_t Start;
+    int32_t End;
+} deck_column;
+
+typedef void deck_column_kernel(const deck_column *Column);
+
+deck_column_kernel *GetDeckColumnKernel(deck_kernel Kernel);
+
+deck_span_kernel *GetDeckSpanKernel(deck_kernel Kernel);
+
+static inline uint32_t ToDeckFixed(float Val) {
+    return (uint32_t) (int64_t) ((double) Val * 4294967296.0);
+}
+
+#endif
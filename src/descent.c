@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -6,6 +7,10 @@
 
 #include "descent.h"
 #include "render.h"
+#include "render_tables.h"
+#include "scalar.h"
+#include "shade.h"
+#include "timer.h"
 
 typedef struct __attribute__((packed)) bitmap_header {
     /*FileHeader*/
@@ -36,8 +41,8 @@ static void MoveCamera(game_state *GS, float Velocity) {
     vec2 NewPos = AddVec2(GS->Pos, PosDelta);
     int32_t TileX = (int32_t) NewPos.X;
     int32_t TileY = (int32_t) NewPos.Y;
-    if(IsInTileMap(TileY, TileX)) {
-        tile_data TileData = GetTileData(GS->TileMap[TileY][TileX]);
+    if(IsInTileMap(&GS->TileMap, TileX, TileY)) {
+        tile_data TileData = GetTileData(GetTile(&GS->TileMap, TileX, TileY));
         if(!(TileData.Flags & TF_SOLID)) { 
             GS->Pos = NewPos;
         }
@@ -50,99 +55,281 @@ static void RotateCamera(game_state *GS, float RotPerSec) {
     GS->Plane = RotateVec2(GS->Plane, Rot);
 }
 
-static bool ReadObject(HANDLE File, LPVOID Obj, DWORD ObjSize) {
-    DWORD BytesRead;
-    return ReadFile(File, Obj, ObjSize, &BytesRead, NULL) && BytesRead == ObjSize; 
+static bool ReadObject(FILE *File, void *Obj, size_t ObjSize) {
+    return fread(Obj, ObjSize, 1, File) == 1; 
 }
 
+/*Square, and a power of two from MIN_TEX_LENGTH to MAX_TEX_LENGTH a side*/
 static bool IsValidBitmapHeader(const bitmap_header *BitmapHeader) {
+    uint32_t Length = BitmapHeader->Width;
     return (
         /*CheckFileHeader*/
         memcmp(&BitmapHeader->Signature, "BM", 2) == 0 &&
 
         /*CheckInfoHeader*/
         BitmapHeader->HeaderSize == 40 &&
-        BitmapHeader->Width == TEX_LENGTH &&
-        BitmapHeader->Height == TEX_LENGTH && 
+        Length >= MIN_TEX_LENGTH &&
+        Length <= MAX_TEX_LENGTH &&
+        (Length & (Length - 1)) == 0 &&
+        BitmapHeader->Height == Length && 
         BitmapHeader->Planes == 1 &&
         BitmapHeader->BitsPerPixel == 32 &&
         BitmapHeader->Compression == 3 /*Bitfield compression*/
     );
 }
 
-#define SIZEOF_TEX (TEX_LENGTH * TEX_LENGTH * 4)
+/*Rows are stored bottom first, so Y counts up from the bottom*/
+static bool ReadTexels(FILE *File, texture *Texture) {
+    color Row[MAX_TEX_LENGTH];
+    int32_t Length = GetTexLength(Texture);
+    for(int32_t Y = 0; Y < Length; Y++) {
+        if(!ReadObject(File, Row, Length * sizeof(*Row))) {
+            return false;
+        }
+        for(int32_t X = 0; X < Length; X++) {
+            Texture->Texels[GetTexelI(X, Y)] = Row[X];
+        }
+    }
+    return true;
+}
 
-static bool ReadTexture(const char *Path, color Texture[TEX_LENGTH][TEX_LENGTH]) {
+/*
+ * A file that cannot be read leaves a magenta texture of the smallest
+ * size. Returns false only when not even that can be allocated.
+ */
+static bool ReadTexture(const char *Path, texture *Texture, bool HasMips) {
     bool Success = false;
-    HANDLE FileHandle = CreateFile(
-        Path,
-        GENERIC_READ,
-        FILE_SHARE_READ, 
-        NULL, 
-        OPEN_EXISTING, 
-        0, 
-        NULL
-    );
-    if(FileHandle == INVALID_HANDLE_VALUE) goto out;
+    FILE *File = fopen(Path, "rb");
+    if(!File) goto out;
 
     bitmap_header BmHeader;
     Success = (
-        ReadObject(FileHandle, &BmHeader, sizeof(BmHeader)) &&
+        ReadObject(File, &BmHeader, sizeof(BmHeader)) &&
         IsValidBitmapHeader(&BmHeader) &&
-        SetFilePointer(FileHandle, BmHeader.DataOffset, NULL, FILE_BEGIN) == BmHeader.DataOffset &&
-        ReadObject(FileHandle, Texture, SIZEOF_TEX)
+        fseek(File, BmHeader.DataOffset, SEEK_SET) == 0 &&
+        CreateTexture(Texture, __builtin_ctz(BmHeader.Width), HasMips) &&
+        ReadTexels(File, Texture)
     );
-    CloseHandle(FileHandle);
+    fclose(File);
 
 out:
-    if(!Success) FillColor(Texture, OpaqueColor(0xFF, 0x00, 0xFF));
-    return Success;
+    if(!Success) {
+        DestroyTexture(Texture);
+        if(!CreateTexture(Texture, MIN_TEX_LOG2, HasMips)) {
+            return false;
+        }
+        FillTexture(Texture, OpaqueColor(0xFF, 0x00, 0xFF));
+    }
+    BuildMips(Texture);
+    return true;
+}
+
+static bool IsValidScreenSize(int32_t Width, int32_t Height) {
+    return (
+        Width >= 16 && Width <= MAX_DIB_WIDTH &&
+        Height >= 16 && Height <= MAX_DIB_HEIGHT &&
+        Height % 2 == 0
+    );
+}
+
+/*Scene height stays even so every floor row has a ceiling row*/
+static void ApplySceneScale(game_state *GS) {
+    int32_t Scale = GS->Scaler.Scale;
+    if(Scale == SCALE_ONE) {
+        GS->Scene = GS->Screen;
+        return;
+    }
+    GS->Scene = (frame_buffer) {
+        .Pixels = GS->SceneMemory,
+        .Width = GS->Screen.Width * Scale / SCALE_ONE,
+        .Height = GS->Screen.Height * Scale / SCALE_ONE & ~1
+    };
 }
 
-void CreateGameState(game_state *GS) {
-    for(size_t I = 0; I < _countof(GS->Workers); I++) {
-        CreateWorker(&GS->Workers[I]);
+/*Fails on a bad screen size or when the framebuffers cannot be allocated*/
+static bool CreateFrameBuffers(game_state *GS) {
+    int32_t Width = GS->Config.Width ?: DIB_WIDTH;
+    int32_t Height = GS->Config.Height ?: DIB_HEIGHT;
+    if(!IsValidScreenSize(Width, Height)) {
+        return false;
     }
 
+    size_t PixelCount = (size_t) Width * Height;
+    GS->Screen = (frame_buffer) {
+        .Pixels = calloc(PixelCount, sizeof(color)),
+        .Width = Width,
+        .Height = Height
+    };
+    bool CanScale = GS->Config.FrameBudgetNS > 0;
+    GS->SceneMemory = CanScale ? calloc(PixelCount, sizeof(color)) : NULL;
+    bool HasBack = GS->Config.PipelinedFrames;
+    GS->BackMemory = HasBack ? calloc(PixelCount, sizeof(color)) : NULL;
+    if(
+        !GS->Screen.Pixels || 
+        (CanScale && !GS->SceneMemory) ||
+        (HasBack && !GS->BackMemory)
+    ) {
+        free(GS->Screen.Pixels);
+        free(GS->SceneMemory);
+        free(GS->BackMemory);
+        return false;
+    }
+
+    /*NeverShowTheBufferBeingRendered*/
+    GS->Presented = GS->Screen;
+    GS->Presented.Pixels = GS->BackMemory ?: GS->Screen.Pixels;
+
+    CreateResScaler(&GS->Scaler, GS->Config.FrameBudgetNS);
+    ApplySceneScale(GS);
+    return true;
+}
+
+bool CreateGameState(game_state *GS) {
+    if(!CreateFrameBuffers(GS)) {
+        return false;
+    }
+    GS->Tables = CreateRenderTables();
+    bool HasTileMap = CreateTileMap(&GS->TileMap, TILE_WIDTH, TILE_HEIGHT);
+    bool HasPool = GS->Tables && HasTileMap && CreateWorkerPool(
+        &GS->Pool, 
+        GS->Config.WorkerCount, 
+        GS->Config.PinWorkers
+    );
+    if(!HasPool) {
+        DestroyTileMap(&GS->TileMap);
+        DestroyRenderTables(GS->Tables);
+        free(GS->BackMemory);
+        free(GS->SceneMemory);
+        free(GS->Screen.Pixels);
+        return false;
+    }
+
+    /*WithoutARendererThreadFramesStaySerial*/
+    if(GS->Config.PipelinedFrames) {
+        GS->Config.PipelinedFrames = CreateAsyncWorker(&GS->Renderer);
+    }
+    CreateFogLevels(GS->FogLevels);
+    GS->FogHorizon = CalcFogHorizon(GS->FogLevels);
+
+    tile_map *Map = &GS->TileMap;
     for(int32_t X = 0; X < TILE_WIDTH; X++) {
-        GS->TileMap[0][X] = TD_WOOD;
-        GS->TileMap[TILE_HEIGHT - 1][X] = TD_WOOD; 
+        SetTile(Map, X, 0, TD_WOOD);
+        SetTile(Map, X, TILE_HEIGHT - 1, TD_WOOD); 
     }
 
     for(int32_t Y = 0; Y < TILE_HEIGHT; Y++) {
-        GS->TileMap[Y][0] = TD_WOOD; 
-        GS->TileMap[Y][TILE_WIDTH - 1] = TD_WOOD; 
+        SetTile(Map, 0, Y, TD_WOOD); 
+        SetTile(Map, TILE_WIDTH - 1, Y, TD_WOOD); 
     }
 
     for(int Y = 4; Y < 15; Y++) {
-        GS->TileMap[Y][6] = TD_GLASS_HORZ;
+        SetTile(Map, 6, Y, TD_GLASS_HORZ);
     }
 
     GS->Dir = (vec2) {-1.0F, 0.0F};
     GS->Pos = (vec2) {5.0F, 5.0F};
     GS->Plane = (vec2) {0.0F, 0.5F};
 
-    ReadTexture("../tex/tex01.bmp", GS->TexData[1]);
-    ReadTexture("../tex/tex02.bmp", GS->TexData[2]);
-    ReadTexture("../tex/tex03.bmp", GS->TexData[3]);
-    ReadTexture("../tex/tex04.bmp", GS->TexData[4]);
+    bool HasMips = !GS->Config.NoMips;
+    bool HasTextures = (
+        CreateTexture(&GS->Textures[0], MIN_TEX_LOG2, HasMips) &&
+        ReadTexture("../tex/tex01.bmp", &GS->Textures[1], HasMips) &&
+        ReadTexture("../tex/tex02.bmp", &GS->Textures[2], HasMips) &&
+        ReadTexture("../tex/tex03.bmp", &GS->Textures[3], HasMips) &&
+        ReadTexture("../tex/tex04.bmp", &GS->Textures[4], HasMips)
+    );
+    if(HasTextures) {
+        GS->Shades = CreateShadeCache(
+            GS->Config.ShadeLevels,
+            TEX_COUNT,
+            GS->Textures
+        );
+    }
+    if(!GS->Shades) {
+        DestroyGameState(GS);
+        return false;
+    }
 
-    GS->SpriteCount = 3;
-    GS->Sprites[0] = (sprite) {
-        .Pos = {8.0F, 8.0F},
-        .Tile = TD_GHOST
-    };
-    GS->Sprites[1] = (sprite) {
-        .Pos = {8.0F, 10.0F},
-        .Tile = TD_GHOST
-    };
-    GS->Sprites[2] = (sprite) {
-        .Pos = {10.0F, 8.0F},
-        .Tile = TD_GHOST
+    static const vec2 s_GhostPos[] = {
+        {8.0F, 8.0F},
+        {8.0F, 10.0F},
+        {10.0F, 8.0F}
     };
+    for(size_t I = 0; I < _countof(s_GhostPos); I++) {
+        sprite Ghost = {
+            .Pos = s_GhostPos[I],
+            .Tile = TD_GHOST
+        };
+        if(!AddSprite(GS, Ghost)) {
+            DestroyGameState(GS);
+            return false;
+        }
+    }
+    UpdateEmptyRadii(Map);
+    return true;
 }
 
-void UpdateGameState(game_state *GS) { 
+void DestroyGameState(game_state *GS) {
+    FinishFrames(GS);
+    if(GS->Config.PipelinedFrames) {
+        DestroyAsyncWorker(&GS->Renderer);
+    }
+    DestroyWorkerPool(&GS->Pool);
+    DestroyRenderTables(GS->Tables);
+    GS->Tables = NULL;
+    DestroyShadeCache(GS->Shades);
+    GS->Shades = NULL;
+    for(int32_t TexI = 0; TexI < TEX_COUNT; TexI++) {
+        DestroyTexture(&GS->Textures[TexI]);
+    }
+    DestroyTileMap(&GS->TileMap);
+    free(GS->Sprites);
+    free(GS->View.Sprites);
+    GS->Sprites = NULL;
+    GS->View = (render_view) {};
+    GS->SpriteCount = 0;
+    GS->SpriteCap = 0;
+    free(GS->BackMemory);
+    free(GS->SceneMemory);
+    free(GS->Screen.Pixels);
+    GS->BackMemory = NULL;
+    GS->SceneMemory = NULL;
+    GS->Screen = (frame_buffer) {};
+    GS->Presented = (frame_buffer) {};
+    GS->Scene = (frame_buffer) {};
+}
+
+/*
+ * The view and the render tables grow with the store so a frame never
+ * allocates them, which a frame in flight must not see happen
+ */
+bool AddSprite(game_state *GS, sprite Sprite) {
+    FinishFrames(GS);
+    if(GS->SpriteCount == GS->SpriteCap) {
+        uint32_t SpriteCap = GS->SpriteCap ? 2 * GS->SpriteCap : 16;
+        sprite *Sprites = realloc(GS->Sprites, SpriteCap * sizeof(*Sprites));
+        if(!Sprites) {
+            return false;
+        }
+        GS->Sprites = Sprites;
+        sprite *ViewSprites = realloc(
+            GS->View.Sprites, 
+            SpriteCap * sizeof(*ViewSprites)
+        );
+        if(!ViewSprites) {
+            return false;
+        }
+        GS->View.Sprites = ViewSprites;
+        if(!ReserveSpriteTables(GS->Tables, SpriteCap)) {
+            return false;
+        }
+        GS->SpriteCap = SpriteCap;
+    }
+    GS->Sprites[GS->SpriteCount++] = Sprite;
+    return true;
+}
+
+static void SimulateFrame(game_state *GS) {
     if(GS->FrameDelta > 0.05F) {
         GS->FrameDelta = 0.05F;
     }
@@ -160,6 +347,61 @@ void UpdateGameState(game_state *GS) {
     if(GS->Buttons[BT_DOWN]) {
         MoveCamera(GS, -3.0F); 
     }
+}
+
+/*Only called with no frame in flight*/
+static void SubmitView(game_state *GS) {
+    UpdateEmptyRadii(&GS->TileMap);
+    ApplySceneScale(GS);
+
+    render_view *View = &GS->View;
+    View->Pos = GS->Pos;
+    View->Dir = GS->Dir;
+    View->Plane = GS->Plane;
+    View->TotalTime = GS->TotalTime;
+    View->SpriteCount = GS->SpriteCount;
+    memcpy(View->Sprites, GS->Sprites, GS->SpriteCount * sizeof(sprite));
+}
 
+/*A new scale is applied when the next frame is submitted*/
+static void RenderFrame(void *Data) {
+    game_state *GS = Data;
+    int64_t Time = QueryTimeNS();
     RenderWorld(GS);
+    UpdateResScaler(&GS->Scaler, QueryTimeNS() - Time);
+}
+
+static void PresentFrame(game_state *GS) {
+    GS->Presented = GS->Screen;
+    GS->RenderStats = GS->FrameStats;
+    GS->PresentedCount++;
+    if(GS->BackMemory) {
+        color *Pixels = GS->Screen.Pixels;
+        GS->Screen.Pixels = GS->BackMemory;
+        GS->BackMemory = Pixels;
+    }
+}
+
+void FinishFrames(game_state *GS) {
+    if(GS->IsFrameInFlight) {
+        JoinAsyncCall(&GS->Renderer);
+        GS->IsFrameInFlight = false;
+        PresentFrame(GS);
+    }
+}
+
+void UpdateGameState(game_state *GS) { 
+    SimulateFrame(GS);
+    if(!GS->Config.PipelinedFrames) {
+        SubmitView(GS);
+        RenderFrame(GS);
+        PresentFrame(GS);
+        return;
+    }
+
+    /*SimulatedWhileThePreviousFrameRendered*/
+    FinishFrames(GS);
+    SubmitView(GS);
+    StartAsyncCall(&GS->Renderer, RenderFrame, GS);
+    GS->IsFrameInFlight = true;
 }
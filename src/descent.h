@@ -1,26 +1,35 @@
 #ifndef DESCENT_HPP 
 #define DESCENT_HPP
 
+#include <stdbool.h>
 #include <stdint.h>
-#include <windows.h>
 
 #include "color.h"
+#include "deck.h"
+#include "layer.h"
+#include "ray_packet.h"
+#include "scaler.h"
+#include "texture.h"
 #include "tile_data.h"
+#include "tile_map.h"
 #include "vec2.h"
 #include "worker.h"
 
+/*Default screen size and the largest screen the renderer takes*/
 #define DIB_WIDTH 640 
 #define DIB_HEIGHT 480 
+#define MAX_DIB_WIDTH 3840
+#define MAX_DIB_HEIGHT 2160
 
-#define TEX_LENGTH 16 
-
-#define TILE_WIDTH 20
-#define TILE_HEIGHT 20 
-
+/*Size of the default room*/
 #define TILE_WIDTH 20
 #define TILE_HEIGHT 20
 
-#define SPR_CAP 256
+#define TEX_COUNT 5 /*Slot 0 stays blank, the others are read at load*/
+
+#define FOG_DIS 5
+#define FOG_STEPS_PER_TILE 64
+#define FOG_LEVEL_COUNT (FOG_DIS * FOG_STEPS_PER_TILE)
 
 typedef enum game_buttons {
     BT_LEFT = 0,
@@ -36,15 +45,94 @@ typedef struct sprite {
     tile Tile;
 } sprite;
 
+/*
+ * What a frame is rendered from. It is copied from the simulation when the
+ * frame is submitted, so the next frame can be simulated while this one
+ * renders. Sprites has room for as many sprites as the sprite store.
+ */
+typedef struct render_view {
+    vec2 Pos;
+    vec2 Dir;
+    vec2 Plane;
+    float TotalTime;
+    uint32_t SpriteCount;
+    sprite *Sprites;
+} render_view;
+
+/*Bottom row first, with rows Width pixels apart*/
+typedef struct frame_buffer {
+    color *Pixels;
+    int32_t Width;
+    int32_t Height;
+} frame_buffer;
+
+/*Lookup tables owned by the renderer, see render_tables.h*/
+typedef struct render_tables render_tables;
+
+/*Textures pre-shaded by the fog, see shade.h*/
+typedef struct shade_cache shade_cache;
+
+typedef struct render_stats {
+    int64_t SortSpritesNS;
+    int64_t ComputeRenderSpriteInfosNS;
+    int64_t RenderDecksNS;
+    int64_t RenderFacingNS;
+    int64_t UpscaleNS;
+    int64_t RenderNS; /*Of the whole frame, as the stages overlap*/
+
+    /*How evenly the frame's jobs spread over the workers*/
+    int64_t DeckSpreadNS; /*Slowest deck job minus the fastest*/
+    int64_t FacingSpreadNS;
+    int32_t WorkerCount;
+    batch_usage Usage;
+
+    int32_t SceneWidth;
+    int32_t SceneHeight;
+} render_stats;
+
+/*Read by CreateGameState, so set before calling it*/
+typedef struct render_config {
+    deck_kernel DeckKernel;
+    ray_kernel RayKernel;
+    layer_kernel LayerKernel;
+    int32_t WorkerCount; /*Zero sizes the pool from the hardware*/
+    bool PinWorkers; /*Each pool thread stays on a core of its own*/
+    bool FusedColumns; /*Decks are filled per column around the walls*/
+    bool PipelinedFrames; /*Frame N renders while N + 1 is simulated*/
+    bool StageBarriers; /*Each render stage waits for all of the last one*/
+    int32_t ShadeLevels; /*Fog levels pre-shaded, zero keeps them all*/
+    bool NoMips; /*Textures load without mips, so always sample full size*/
+
+    /*Screen size, zero for DIB_WIDTH by DIB_HEIGHT. Height must be even*/
+    int32_t Width;
+    int32_t Height;
+    int64_t FrameBudgetNS; /*Nonzero lets the scene shrink to fit it*/
+} render_config;
+
+/*
+ * With PipelinedFrames a submitted frame renders on its own thread until
+ * the next UpdateGameState or FinishFrames joins it. That frame reads the
+ * tile map, so tiles only change while no frame is in flight.
+ */
 typedef struct game_state {
     /*OtherRendering*/
-    color Pixels[DIB_HEIGHT][DIB_WIDTH];
-    color TexData[SPR_CAP][TEX_LENGTH][TEX_LENGTH];
-    uint8_t TileMap[TILE_HEIGHT][TILE_WIDTH];
-
-    /*Sprite*/
+    frame_buffer Screen; /*Written by the frame being rendered*/
+    frame_buffer Presented; /*Last finished frame, what the window shows*/
+    color *BackMemory; /*The other screen buffer, only when pipelined*/
+    frame_buffer Scene; /*Upscaled into Screen when smaller than it*/
+    color *SceneMemory;
+    res_scaler Scaler;
+    render_tables *Tables;
+    texture Textures[TEX_COUNT];
+    shade_cache *Shades; /*Of Textures*/
+    tile_map TileMap;
+    uint8_t FogLevels[FOG_LEVEL_COUNT];
+    float FogHorizon; /*Nothing at or past this distance survives the fog*/
+
+    /*Sprite, grown by AddSprite*/
     uint32_t SpriteCount;
-    sprite Sprites[SPR_CAP];
+    uint32_t SpriteCap;
+    sprite *Sprites;
 
     /*Camera*/
     vec2 Pos; 
@@ -57,10 +145,29 @@ typedef struct game_state {
     float FrameDelta;
     float TotalTime;
 
-    worker Workers[4];
+    worker_pool Pool;
+    render_config Config;
+    render_view View;
+    async_worker Renderer;
+    bool IsFrameInFlight;
+    int64_t PresentedCount;
+    render_stats FrameStats; /*Of the frame being rendered*/
+    render_stats RenderStats; /*Of the presented frame*/
 } game_state;
 
-void CreateGameState(game_state *GS);
+bool CreateGameState(game_state *GS);
+void DestroyGameState(game_state *GS);
+
+/*
+ * Simulates a frame and submits it. Pipelined, it returns with that frame
+ * still rendering and the one before it presented.
+ */
 void UpdateGameState(game_state *GS);
 
+/*Waits for the frame in flight, if any, and presents it*/
+void FinishFrames(game_state *GS);
+
+/*Returns false when the sprite store cannot grow. Finishes frames first*/
+bool AddSprite(game_state *GS, sprite Sprite);
+
 #endif
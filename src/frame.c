@@ -28,7 +28,9 @@ frame CreateFrame(float FPS) {
         .PerfFreq = QueryPerfFreq(),
         .BeginCounter = QueryPerfFreq(),
         .DeltaCounter = 0LL,
-        .PeriodCounter = (int64_t) ((float) Result.PerfFreq / FPS)
+        .PeriodCounter = (
+            FPS > 0.0F ? (int64_t) ((float) Result.PerfFreq / FPS) : 0LL
+        )
     };
 
     FARPROC Procs[2];
@@ -18,6 +18,7 @@ typedef struct frame {
     bool IsGranular;
 } frame;
 
+/*An FPS of zero leaves the frame rate uncapped*/
 frame CreateFrame(float FPS);
 void DestroyFrame(frame *Frame);
 
@@ -0,0 +1,85 @@
+#include <stddef.h>
+
+#include "layer.h"
+
+static void LayerRunScalar(
+    int32_t Count,
+    color Pixels[static Count],
+    const color Texels[static Count],
+    bool Side
+) {
+    for(int32_t I = 0; I < Count; I++) {
+        color Layered = LayerColor(Pixels[I], Texels[I]);
+        Pixels[I] = Side ? HalfColor(Layered) : Layered;
+    }
+}
+
+#ifdef __SSE2__
+
+static void LayerRunSSE2(
+    int32_t Count,
+    color Pixels[static Count],
+    const color Texels[static Count],
+    bool Side
+) {
+    int32_t I = 0;
+    for(; I + 4 <= Count; I += 4) {
+        __m128i *Out = (__m128i *) &Pixels[I];
+        color4 Layered = LayerColor4(
+            _mm_loadu_si128(Out),
+            _mm_loadu_si128((const __m128i *) &Texels[I])
+        );
+        _mm_storeu_si128(Out, Side ? HalfColor4(Layered) : Layered);
+    }
+    LayerRunScalar(Count - I, &Pixels[I], &Texels[I], Side);
+}
+
+#endif
+
+#ifdef COLOR_X86
+
+__attribute__((target("avx2")))
+static void LayerRunAVX2(
+    int32_t Count,
+    color Pixels[static Count],
+    const color Texels[static Count],
+    bool Side
+) {
+    int32_t I = 0;
+    for(; I + 8 <= Count; I += 8) {
+        __m256i *Out = (__m256i *) &Pixels[I];
+        color8 Layered = LayerColor8(
+            _mm256_loadu_si256(Out),
+            _mm256_loadu_si256((const __m256i *) &Texels[I])
+        );
+        _mm256_storeu_si256(Out, Side ? HalfColor8(Layered) : Layered);
+    }
+    LayerRunScalar(Count - I, &Pixels[I], &Texels[I], Side);
+}
+
+#endif
+
+layer_run_kernel *GetLayerRunKernel(layer_kernel Kernel) {
+    switch(Kernel) {
+    case LK_AUTO:
+        if(HasAVX2()) {
+            return GetLayerRunKernel(LK_AVX2);
+        }
+        return GetLayerRunKernel(LK_SSE2) ?: LayerRunScalar;
+    case LK_SCALAR:
+        return LayerRunScalar;
+    case LK_SSE2:
+#ifdef __SSE2__
+        return LayerRunSSE2;
+#else
+        return NULL;
+#endif
+    case LK_AVX2:
+#ifdef COLOR_X86
+        return HasAVX2() ? LayerRunAVX2 : NULL;
+#else
+        return NULL;
+#endif
+    }
+    return NULL;
+}
@@ -0,0 +1,31 @@
+#ifndef LAYER_H
+#define LAYER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "color.h"
+
+typedef enum layer_kernel {
+    LK_AUTO,
+    LK_SCALAR,
+    LK_SSE2,
+    LK_AVX2
+} layer_kernel;
+
+/*
+ * Layers a run of texels over the pixels under them with LayerColor, so
+ * each texel's own alpha decides how much shows through. Side halves the
+ * result with HalfColor, which darkens what shows through as well.
+ */
+typedef void layer_run_kernel(
+    int32_t Count,
+    color Pixels[static Count],
+    const color Texels[static Count],
+    bool Side
+);
+
+/*Returns NULL when the requested kernel is not available on this CPU*/
+layer_run_kernel *GetLayerRunKernel(layer_kernel Kernel);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <windows.h>
 #include <stdbool.h>
+#include <string.h>
 #include <xinput.h>
 
 #include "audio.h"
@@ -17,20 +18,25 @@ typedef struct xinput {
 } xinput; 
 
 #define MY_WS_FLAGS (WS_VISIBLE | WS_SYSMENU | WS_CAPTION) 
+#define FRAME_BUDGET_NS (1000000000LL / 60)
 
-static const BITMAPINFO g_DIBInfo = {
-    .bmiHeader = {
-        .biSize = sizeof(g_DIBInfo.bmiHeader),
-        .biWidth = DIB_WIDTH,
-        .biHeight = DIB_HEIGHT,
-        .biPlanes = 1,
-        .biBitCount = 32,
-        .biCompression = BI_RGB
-    }
-};
-
+static BITMAPINFO g_DIBInfo;
 static game_state g_GameState;
 
+/*Positive height, so the DIB is bottom-up like the screen buffer*/
+static void SetDIBInfo(const frame_buffer *Screen) {
+    g_DIBInfo = (BITMAPINFO) {
+        .bmiHeader = {
+            .biSize = sizeof(g_DIBInfo.bmiHeader),
+            .biWidth = Screen->Width,
+            .biHeight = Screen->Height,
+            .biPlanes = 1,
+            .biBitCount = 32,
+            .biCompression = BI_RGB
+        }
+    };
+}
+
 static void SetWindowState(
     HWND Window, 
     DWORD Style, 
@@ -150,6 +156,7 @@ static int FindButtonFromKey(size_t VKey) {
 static BOOL ToggleFullscreen(HWND Window) {
     static RECT RestoreRect = {}; 
     static BOOL IsFullscreen = FALSE;
+    const frame_buffer *Screen = &g_GameState.Screen;
 
     /*RestoreFromFullscreen*/
     if(IsFullscreen) { 
@@ -161,8 +168,8 @@ static BOOL ToggleFullscreen(HWND Window) {
             MY_WS_FLAGS, 
             RestoreRect.left, 
             RestoreRect.top,
-            DIB_WIDTH,
-            DIB_HEIGHT
+            Screen->Width,
+            Screen->Height
         ); 
         ShowCursor(TRUE);
         IsFullscreen = FALSE;
@@ -175,14 +182,21 @@ static BOOL ToggleFullscreen(HWND Window) {
     DEVMODE DevMode = {
         .dmSize = sizeof(DevMode),
         .dmFields = DM_PELSWIDTH | DM_PELSHEIGHT,
-        .dmPelsWidth = DIB_WIDTH,
-        .dmPelsHeight = DIB_HEIGHT
+        .dmPelsWidth = Screen->Width,
+        .dmPelsHeight = Screen->Height
     };
     LONG DispState = ChangeDisplaySettings(&DevMode, CDS_FULLSCREEN);
     if(DispState != DISP_CHANGE_SUCCESSFUL) {
         return FALSE;
     }
-    SetWindowState(Window, WS_POPUP | WS_VISIBLE, 0, 0, DIB_WIDTH, DIB_HEIGHT); 
+    SetWindowState(
+        Window, 
+        WS_POPUP | WS_VISIBLE, 
+        0, 
+        0, 
+        Screen->Width, 
+        Screen->Height
+    ); 
     ShowCursor(FALSE);
     IsFullscreen = TRUE;
     return TRUE;
@@ -240,17 +254,18 @@ static LRESULT WndProc(
         {
             PAINTSTRUCT Paint;
             HDC DeviceContext = BeginPaint(Window, &Paint);
+            const frame_buffer *Screen = &g_GameState.Presented;
             SetDIBitsToDevice(
                 DeviceContext,
                 0,
                 0,
-                DIB_WIDTH,
-                DIB_HEIGHT,
+                Screen->Width,
+                Screen->Height,
                 0,
                 0,
                 0U,
-                DIB_HEIGHT,
-                g_GameState.Pixels,
+                Screen->Height,
+                Screen->Pixels,
                 &g_DIBInfo,
                 DIB_RGB_COLORS
             );
@@ -260,10 +275,34 @@ static LRESULT WndProc(
     return DefWindowProc(Window, Message, WParam, LParam);
 }
 
+/*
+ * "-size WxH" sets the screen and "-budget-us N" the frame time the scene
+ * shrinks to fit, which defaults to 60 Hz. A budget of 0 keeps the scene
+ * at screen size.
+ */
+static void ReadRenderConfig(render_config *Config, LPCSTR CmdLine) {
+    Config->PipelinedFrames = true;
+    Config->FrameBudgetNS = FRAME_BUDGET_NS;
+
+    const char *Size = strstr(CmdLine, "-size ");
+    int Width;
+    int Height;
+    if(Size && sscanf(Size, "-size %dx%d", &Width, &Height) == 2) {
+        Config->Width = Width;
+        Config->Height = Height;
+    }
+
+    const char *Budget = strstr(CmdLine, "-budget-us ");
+    int BudgetUS;
+    if(Budget && sscanf(Budget, "-budget-us %d", &BudgetUS) == 1) {
+        Config->FrameBudgetNS = BudgetUS > 0 ? BudgetUS * 1000LL : 0;
+    }
+}
+
 int WINAPI WinMain(
     HINSTANCE Instance, 
     [[maybe_unused]] HINSTANCE PrevInstance, 
-    [[maybe_unused]] LPSTR CmdLine, 
+    LPSTR CmdLine, 
     [[maybe_unused]] int CmdShow
 ) {
     /*InitAudio*/
@@ -287,10 +326,18 @@ int WINAPI WinMain(
         return EXIT_FAILURE;
     }
 
+    /*InitGameState*/
+    ReadRenderConfig(&g_GameState.Config, CmdLine);
+    if(!CreateGameState(&g_GameState)) {
+        MessageError("CreateGameState failed"); 
+        return EXIT_FAILURE;
+    }
+    SetDIBInfo(&g_GameState.Screen);
+
     /*InitWindow*/
     RECT WindowRect = {
-        .right = DIB_WIDTH, 
-        .bottom = DIB_HEIGHT 
+        .right = g_GameState.Screen.Width, 
+        .bottom = g_GameState.Screen.Height 
     };
     AdjustWindowRect(&WindowRect, MY_WS_FLAGS, FALSE);
 
@@ -313,9 +360,9 @@ int WINAPI WinMain(
     }
 
     /*InitMisc*/
-    frame Frame = CreateFrame(60.0F);
+    bool IsUncapped = strstr(CmdLine, "-uncapped") != NULL;
+    frame Frame = CreateFrame(IsUncapped ? 0.0F : 60.0F);
     xinput XInput = LoadXInput();
-    CreateGameState(&g_GameState); 
 
     /*MainLoop*/
     while(true) {
@@ -335,6 +382,7 @@ int WINAPI WinMain(
     }
 
     DestroyFrame(&Frame);
+    DestroyGameState(&g_GameState);
     DestroyXAudio2(&XAudio2); 
     DestroyCom(&Com);
 
@@ -0,0 +1,269 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "color.h"
+#include "ray_packet.h"
+#include "scalar.h"
+
+#define MAX_RAY_LANES 8
+
+/*
+ * Packet state as one array per field so a vector loads a field for all
+ * lanes. Counts are kept as floats, exact far past any map size, so they
+ * multiply into crossings the way CalcCrossing converts them. Tiles are
+ * tracked by their index into the map instead of by X and Y.
+ */
+typedef struct ray_lanes {
+    float BaseX[MAX_RAY_LANES];
+    float BaseY[MAX_RAY_LANES];
+    float DeltaX[MAX_RAY_LANES];
+    float DeltaY[MAX_RAY_LANES];
+    float CountX[MAX_RAY_LANES];
+    float CountY[MAX_RAY_LANES];
+    float NextX[MAX_RAY_LANES];
+    float NextY[MAX_RAY_LANES];
+    int32_t TileI[MAX_RAY_LANES];
+    int32_t StepIX[MAX_RAY_LANES];
+    int32_t StepIY[MAX_RAY_LANES];
+} ray_lanes;
+
+/*Lanes past Count repeat the last ray, which only ends a packet early*/
+static void LoadRayLanes(
+    ray_lanes *Lanes,
+    const tile_map *Map,
+    int32_t Width,
+    int32_t Count,
+    const ray_walk Walks[static Count]
+) {
+    for(int32_t L = 0; L < Width; L++) {
+        const ray_walk *Walk = &Walks[MIN(L, Count - 1)];
+        Lanes->BaseX[L] = Walk->BaseX;
+        Lanes->BaseY[L] = Walk->BaseY;
+        Lanes->DeltaX[L] = Walk->DeltaX;
+        Lanes->DeltaY[L] = Walk->DeltaY;
+        Lanes->CountX[L] = (float) Walk->CountX;
+        Lanes->CountY[L] = (float) Walk->CountY;
+        Lanes->NextX[L] = Walk->NextX;
+        Lanes->NextY[L] = Walk->NextY;
+        Lanes->TileI[L] = GetTileI(Map, Walk->TileX, Walk->TileY);
+        Lanes->StepIX[L] = Walk->StepX;
+        Lanes->StepIY[L] = Walk->StepY * Map->Stride;
+    }
+}
+
+static void StoreRayLanes(
+    const ray_lanes *Lanes,
+    int32_t Count,
+    ray_walk Walks[static Count]
+) {
+    for(int32_t L = 0; L < Count; L++) {
+        ray_walk *Walk = &Walks[L];
+        int32_t CountX = (int32_t) Lanes->CountX[L];
+        int32_t CountY = (int32_t) Lanes->CountY[L];
+        Walk->TileX += Walk->StepX * (CountX - Walk->CountX);
+        Walk->TileY += Walk->StepY * (CountY - Walk->CountY);
+        Walk->CountX = CountX;
+        Walk->CountY = CountY;
+        Walk->NextX = Lanes->NextX[L];
+        Walk->NextY = Lanes->NextY[L];
+    }
+}
+
+/*The scalar kernel leaves every ray to walk on its own*/
+static void AdvanceRayPacketScalar(
+    [[maybe_unused]] const tile_map *Map,
+    [[maybe_unused]] float FogHorizon,
+    int32_t Count,
+    [[maybe_unused]] ray_walk Walks[static Count]
+) {
+}
+
+#ifdef __SSE2__
+
+static inline __m128 SelectSSE2(__m128 Mask, __m128 A, __m128 B) {
+    return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B));
+}
+
+static inline __m128 CalcCrossingSSE2(
+    __m128 Base,
+    __m128 Delta,
+    __m128 Count
+) {
+    __m128 Crossing = _mm_add_ps(Base, _mm_mul_ps(Count, Delta));
+    return SelectSSE2(_mm_cmpeq_ps(Count, _mm_setzero_ps()), Base, Crossing);
+}
+
+/*Four rays per packet, with the tiles loaded one lane at a time*/
+static void AdvanceRayPacketSSE2(
+    const tile_map *Map,
+    float FogHorizon,
+    int32_t Count,
+    ray_walk Walks[static Count]
+) {
+    __m128 Horizon = _mm_set1_ps(FogHorizon);
+    __m128 One = _mm_set1_ps(1.0F);
+    ray_lanes Lanes;
+    for(int32_t Start = 0; Start < Count; Start += 4) {
+        int32_t LaneCount = MIN(Count - Start, 4);
+        LoadRayLanes(&Lanes, Map, 4, LaneCount, &Walks[Start]);
+        __m128 BaseX = _mm_loadu_ps(Lanes.BaseX);
+        __m128 BaseY = _mm_loadu_ps(Lanes.BaseY);
+        __m128 DeltaX = _mm_loadu_ps(Lanes.DeltaX);
+        __m128 DeltaY = _mm_loadu_ps(Lanes.DeltaY);
+        __m128 CountX = _mm_loadu_ps(Lanes.CountX);
+        __m128 CountY = _mm_loadu_ps(Lanes.CountY);
+        __m128 NextX = _mm_loadu_ps(Lanes.NextX);
+        __m128 NextY = _mm_loadu_ps(Lanes.NextY);
+        __m128i TileI = _mm_loadu_si128((const __m128i *) Lanes.TileI);
+        __m128i StepIX = _mm_loadu_si128((const __m128i *) Lanes.StepIX);
+        __m128i StepIY = _mm_loadu_si128((const __m128i *) Lanes.StepIY);
+
+        while(true) {
+            /*StepEveryLaneLikeStepRayWalk*/
+            __m128 TakeX = _mm_cmplt_ps(NextX, NextY);
+            __m128 Dist = SelectSSE2(TakeX, NextX, NextY);
+            __m128i TakeXI = _mm_castps_si128(TakeX);
+            __m128i NextTileI = _mm_add_epi32(
+                TileI,
+                _mm_or_si128(
+                    _mm_and_si128(TakeXI, StepIX),
+                    _mm_andnot_si128(TakeXI, StepIY)
+                )
+            );
+
+            /*StopBeforeAnyHitOrFog*/
+            int32_t I[4];
+            _mm_storeu_si128((__m128i *) I, NextTileI);
+            bool HasTile = false;
+            for(int32_t L = 0; L < 4; L++) {
+                HasTile |= Map->Memory[I[L]] != TD_NONE;
+            }
+            if(HasTile || _mm_movemask_ps(_mm_cmpge_ps(Dist, Horizon))) {
+                break;
+            }
+
+            TileI = NextTileI;
+            CountX = _mm_add_ps(CountX, _mm_and_ps(TakeX, One));
+            CountY = _mm_add_ps(CountY, _mm_andnot_ps(TakeX, One));
+            NextX = CalcCrossingSSE2(BaseX, DeltaX, CountX);
+            NextY = CalcCrossingSSE2(BaseY, DeltaY, CountY);
+        }
+
+        _mm_storeu_ps(Lanes.CountX, CountX);
+        _mm_storeu_ps(Lanes.CountY, CountY);
+        _mm_storeu_ps(Lanes.NextX, NextX);
+        _mm_storeu_ps(Lanes.NextY, NextY);
+        StoreRayLanes(&Lanes, LaneCount, &Walks[Start]);
+    }
+}
+
+#endif
+
+#ifdef COLOR_X86
+
+__attribute__((target("avx2")))
+static inline __m256 CalcCrossingAVX2(
+    __m256 Base,
+    __m256 Delta,
+    __m256 Count
+) {
+    __m256 Crossing = _mm256_add_ps(Base, _mm256_mul_ps(Count, Delta));
+    __m256 IsStart = _mm256_cmp_ps(Count, _mm256_setzero_ps(), _CMP_EQ_OQ);
+    return _mm256_blendv_ps(Crossing, Base, IsStart);
+}
+
+/*
+ * Eight rays per packet. Tiles are gathered as the four bytes starting at
+ * each cell, which the map pads for, and masked down to the cell.
+ */
+__attribute__((target("avx2")))
+static void AdvanceRayPacketAVX2(
+    const tile_map *Map,
+    float FogHorizon,
+    int32_t Count,
+    ray_walk Walks[static Count]
+) {
+    __m256 Horizon = _mm256_set1_ps(FogHorizon);
+    __m256 One = _mm256_set1_ps(1.0F);
+    __m256i TileMask = _mm256_set1_epi32(0xFF);
+    __m256i NoTile = _mm256_set1_epi32(TD_NONE);
+    const int *Memory = (const int *) Map->Memory;
+    ray_lanes Lanes;
+    for(int32_t Start = 0; Start < Count; Start += 8) {
+        int32_t LaneCount = MIN(Count - Start, 8);
+        LoadRayLanes(&Lanes, Map, 8, LaneCount, &Walks[Start]);
+        __m256 BaseX = _mm256_loadu_ps(Lanes.BaseX);
+        __m256 BaseY = _mm256_loadu_ps(Lanes.BaseY);
+        __m256 DeltaX = _mm256_loadu_ps(Lanes.DeltaX);
+        __m256 DeltaY = _mm256_loadu_ps(Lanes.DeltaY);
+        __m256 CountX = _mm256_loadu_ps(Lanes.CountX);
+        __m256 CountY = _mm256_loadu_ps(Lanes.CountY);
+        __m256 NextX = _mm256_loadu_ps(Lanes.NextX);
+        __m256 NextY = _mm256_loadu_ps(Lanes.NextY);
+        __m256i TileI = _mm256_loadu_si256((const __m256i *) Lanes.TileI);
+        __m256i StepIX = _mm256_loadu_si256((const __m256i *) Lanes.StepIX);
+        __m256i StepIY = _mm256_loadu_si256((const __m256i *) Lanes.StepIY);
+
+        while(true) {
+            /*StepEveryLaneLikeStepRayWalk*/
+            __m256 TakeX = _mm256_cmp_ps(NextX, NextY, _CMP_LT_OQ);
+            __m256 Dist = _mm256_blendv_ps(NextY, NextX, TakeX);
+            __m256i NextTileI = _mm256_add_epi32(
+                TileI,
+                _mm256_blendv_epi8(StepIY, StepIX, _mm256_castps_si256(TakeX))
+            );
+
+            /*StopBeforeAnyHitOrFog*/
+            __m256i Tiles = _mm256_and_si256(
+                _mm256_i32gather_epi32(Memory, NextTileI, 1),
+                TileMask
+            );
+            __m256 IsEmpty = _mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(Tiles, NoTile)
+            );
+            __m256 IsFog = _mm256_cmp_ps(Dist, Horizon, _CMP_GE_OQ);
+            if(_mm256_movemask_ps(_mm256_andnot_ps(IsFog, IsEmpty)) != 0xFF) {
+                break;
+            }
+
+            TileI = NextTileI;
+            CountX = _mm256_add_ps(CountX, _mm256_and_ps(TakeX, One));
+            CountY = _mm256_add_ps(CountY, _mm256_andnot_ps(TakeX, One));
+            NextX = CalcCrossingAVX2(BaseX, DeltaX, CountX);
+            NextY = CalcCrossingAVX2(BaseY, DeltaY, CountY);
+        }
+
+        _mm256_storeu_ps(Lanes.CountX, CountX);
+        _mm256_storeu_ps(Lanes.CountY, CountY);
+        _mm256_storeu_ps(Lanes.NextX, NextX);
+        _mm256_storeu_ps(Lanes.NextY, NextY);
+        StoreRayLanes(&Lanes, LaneCount, &Walks[Start]);
+    }
+}
+
+#endif
+
+ray_packet_kernel *GetRayPacketKernel(ray_kernel Kernel) {
+    switch(Kernel) {
+    case RK_AUTO:
+        if(HasAVX2()) {
+            return GetRayPacketKernel(RK_AVX2);
+        }
+        return GetRayPacketKernel(RK_SSE2) ?: AdvanceRayPacketScalar;
+    case RK_SCALAR:
+        return AdvanceRayPacketScalar;
+    case RK_SSE2:
+#ifdef __SSE2__
+        return AdvanceRayPacketSSE2;
+#else
+        return NULL;
+#endif
+    case RK_AVX2:
+#ifdef COLOR_X86
+        return HasAVX2() ? AdvanceRayPacketAVX2 : NULL;
+#else
+        return NULL;
+#endif
+    }
+    return NULL;
+}
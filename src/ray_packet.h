@@ -0,0 +1,56 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include <stdint.h>
+
+#include "tile_map.h"
+
+typedef enum ray_kernel {
+    RK_AUTO,
+    RK_SCALAR,
+    RK_SSE2,
+    RK_AVX2
+} ray_kernel;
+
+/*
+ * DDA state along one ray. The Nth grid line crossing on an axis is at
+ * Base + N * Delta, computed directly rather than summed up step by step,
+ * so a run of crossings can be skipped and still land on the same values.
+ */
+typedef struct ray_walk {
+    int32_t TileX;
+    int32_t TileY;
+    int32_t StepX;
+    int32_t StepY;
+    float BaseX;
+    float BaseY;
+    float DeltaX;
+    float DeltaY;
+    int32_t CountX; /*Crossings taken so far*/
+    int32_t CountY;
+    float NextX;
+    float NextY;
+} ray_walk;
+
+/*
+ * Walks adjacent rays in lock-step, one step each per round, while every
+ * ray only enters empty cells short of the fog. The round where any ray
+ * would reach a hit or the fog is not taken, so each ray is left exactly
+ * where stepping it alone would have put it and finishes on its own. The
+ * rays must start inside the map.
+ */
+typedef void ray_packet_kernel(
+    const tile_map *Map,
+    float FogHorizon,
+    int32_t Count,
+    ray_walk Walks[static Count]
+);
+
+/*Returns NULL when the requested kernel is not available on this CPU*/
+ray_packet_kernel *GetRayPacketKernel(ray_kernel Kernel);
+
+static inline float CalcCrossing(float Base, float Delta, int32_t Count) {
+    return Count ? Base + (float) Count * Delta : Base;
+}
+
+#endif
@@ -1,93 +1,258 @@
+#include <string.h>
+
 #include "render.h"
+#include "layer.h"
+#include "ray_packet.h"
+#include "render_tables.h"
 #include "scalar.h"
+#include "shade.h"
+#include "timer.h"
+#include "transpose.h"
+#include "upscale.h"
 #include "vec2.h"
 #include "tile_data.h"
 
 #define MAX_TILE_HITS 32 
+#define FACING_BLOCK 8
+
+/*Job sizes are small so idle workers have work left to steal*/
+#define DECK_JOB_ROWS 8
+#define FACING_JOB_COLS 16
+#define UPSCALE_JOB_ROWS 16
 
-#define SWAP(A, B) do {\
-    __auto_type A_ = (A);\
-    __auto_type B_ = (B);\
-    __auto_type Tmp = *A_;\
-    *A_ = *B_;\
-    *B_ = Tmp;\
-} while(0)
-
-typedef struct sprite_render_info {
-    float TransformY;
-    int32_t SpriteScreenX;
-    int32_t SpriteWidth; 
-    int32_t SpriteHeight;
-    float FogEffect;
-
-    int32_t DrawStartX;
-    int32_t DrawEndX;
-    int32_t DrawStartY;
-    int32_t DrawEndY;
-    int32_t VMoveScreen;
-} sprite_render_info;
+/*Sprites nearer than this overflow their projected size*/
+#define SPRITE_NEAR_DIST 0.01F
+
+/*Shorter skips cost more to compute than the steps they save*/
+#define MIN_SKIP_REACH 2
 
 typedef struct render_decks_data {
     game_state *GS;
-    int StartY;
-    int EndY;
+    deck_span_kernel *Kernel;
 } render_decks_data;
 
+/*FusedColumns fills the decks per column around the walls*/
 typedef struct render_facing_data {
     game_state *GS;
-    int StartX;
-    int EndX;
     sprite_render_info *SpriteRenderInfos;
+    deck_column_kernel *DeckKernel;
+    ray_packet_kernel *RayKernel;
+    layer_run_kernel *LayerKernel;
+    bool FusedColumns;
 } render_facing_data;
 
+/*Index of the first job of each stage in the frame graph*/
+typedef struct frame_jobs {
+    int32_t Infos;
+    int32_t Sort;
+    int32_t Tables;
+    int32_t Decks;
+    int32_t DeckCount;
+    int32_t Facing;
+    int32_t FacingCount;
+    int32_t Upscale;
+    int32_t UpscaleCount;
+} frame_jobs;
+
 typedef struct tile_hit {
     float PerpWallDist;
     tile_data TileData;
     bool Side;
-    int32_t SpriteI;
 } tile_hit; 
 
-void FillColor(color Texture[static TEX_LENGTH][TEX_LENGTH], color Color) {
-    for(int Y = 0; Y < TEX_LENGTH; Y++) {
-        for(int X = 0; X < TEX_LENGTH; X++) {
-            Texture[Y][X] = Color;
-        }
-    } 
-}
+/*
+ * FogStop marks a ray that ran into the fog rather than a wall, so only
+ * the fog is behind its hits. Sprites at or past Depth are hidden.
+ * SpriteStart and SpriteEnd bound the rows of the sprites that are not.
+ */
+typedef struct facing_column {
+    float RayDirX;
+    float RayDirY;
+    bool FogStop;
+    float Depth;
+    int32_t SpriteStart;
+    int32_t SpriteEnd;
+    int32_t TileHitCount;
+    int32_t DrawStart;
+    int32_t DrawEnd;
+    tile_hit TileHits[MAX_TILE_HITS];
+} facing_column;
+
+typedef struct wall_span {
+    int32_t LineHeight;
+    int32_t DrawStart;
+    int32_t DrawEnd;
+} wall_span;
 
 static float CalcFogEffect(float Dis) {
-    return Dis < 5.0F ? 1.0F - Dis / 5.0F : 0.0F;
+    return Dis < FOG_DIS ? 1.0F - Dis / FOG_DIS : 0.0F;
 }
 
-static void SortSprites(game_state *GS) {
-    float SpriteSquareDis[SPR_CAP];
-    for(uint32_t I = 0; I < GS->SpriteCount; I++) {
-        SpriteSquareDis[I] = SquareDisVec2(GS->Pos, GS->Sprites[I].Pos);
-        for(int32_t J = I; J > 0; J--) {
-            if(SpriteSquareDis[J] < SpriteSquareDis[J - 1]) {
-                break;
-            }
-            SWAP(&GS->Sprites[J], &GS->Sprites[J - 1]); 
-            SWAP(&SpriteSquareDis[J], &SpriteSquareDis[J - 1]); 
+void CreateFogLevels(uint8_t FogLevels[static FOG_LEVEL_COUNT]) {
+    for(int32_t I = 0; I < FOG_LEVEL_COUNT; I++) {
+        float Dis = (float) I / FOG_STEPS_PER_TILE;
+        FogLevels[I] = (uint8_t) (CalcFogEffect(Dis) * 255.0F + 0.5F);
+    }
+}
+
+/*
+ * The table only falls, so from the first black step on everything is
+ * black. Steps are powers of two apart, so comparing a distance against
+ * the horizon agrees exactly with CalcFogLevel.
+ */
+float CalcFogHorizon(const uint8_t FogLevels[static FOG_LEVEL_COUNT]) {
+    int32_t I = 0;
+    while(I < FOG_LEVEL_COUNT && FogLevels[I] != 0) {
+        I++;
+    }
+    return (float) I / FOG_STEPS_PER_TILE;
+}
+
+/*Below this many visible sprites the histograms cost more than they save*/
+#define SPRITE_RADIX_MIN 64
+
+static void InsertionSortSprites(sprite_tables *Sprites) {
+    uint32_t *Order = Sprites->Order;
+    for(uint32_t I = 1; I < Sprites->VisibleCount; I++) {
+        uint32_t SpriteI = Order[I];
+        uint16_t Key = Sprites->Keys[SpriteI];
+        uint32_t J = I;
+        for(; J > 0 && Sprites->Keys[Order[J - 1]] > Key; J--) {
+            Order[J] = Order[J - 1];
+        }
+        Order[J] = SpriteI;
+    }
+}
+
+/*
+ * Stable LSD radix sort of the visible sprites on their 16-bit depth
+ * keys, a byte per pass, so equal keys keep their store order.
+ */
+static void SortSprites(sprite_tables *Sprites) {
+    if(Sprites->VisibleCount < SPRITE_RADIX_MIN) {
+        InsertionSortSprites(Sprites);
+        return;
+    }
+    uint32_t *Src = Sprites->Order;
+    uint32_t *Dst = Sprites->SortTemp;
+    for(int32_t Shift = 0; Shift < 16; Shift += 8) {
+        uint32_t Counts[256] = {};
+        for(uint32_t I = 0; I < Sprites->VisibleCount; I++) {
+            Counts[Sprites->Keys[Src[I]] >> Shift & 0xFF]++;
         }
+
+        uint32_t Offset = 0;
+        for(int32_t Digit = 0; Digit < 256; Digit++) {
+            uint32_t Count = Counts[Digit];
+            Counts[Digit] = Offset;
+            Offset += Count;
+        }
+
+        for(uint32_t I = 0; I < Sprites->VisibleCount; I++) {
+            uint32_t SpriteI = Src[I];
+            Dst[Counts[Sprites->Keys[SpriteI] >> Shift & 0xFF]++] = SpriteI;
+        }
+
+        uint32_t *Tmp = Src;
+        Src = Dst;
+        Dst = Tmp;
     }
 } 
 
-static void ComputeRenderSpriteInfos(
-    game_state *GS, 
-    sprite_render_info SpriteRenderInfos[SPR_CAP]
+static bool IsSpriteOnScreen(const sprite_render_info *Info) {
+    return Info->DrawStartX < Info->DrawEndX;
+}
+
+/*
+ * Counts the sprites per bin first so each bin gets a contiguous run of
+ * Items, then fills the runs in sorted order. Sprites with an empty
+ * column range land in no bin. If Items cannot grow, the bins stay empty
+ * and no sprite is drawn this frame.
+ */
+static void BinSprites(
+    const game_state *GS, 
+    const sprite_tables *Sprites,
+    sprite_bins *Bins
 ) {
-    int32_t BobCycle = (int32_t) (GS->TotalTime * 16) % 16;
+    int32_t BinCount = (
+        (GS->Scene.Width + SPRITE_BIN_WIDTH - 1) / SPRITE_BIN_WIDTH
+    );
+    Bins->BinCount = BinCount;
+    memset(Bins->Start, 0, (BinCount + 1) * sizeof(*Bins->Start));
+
+    /*CountPerBin*/
+    for(uint32_t I = 0; I < Sprites->VisibleCount; I++) {
+        const sprite_render_info *Info = &Sprites->Infos[Sprites->Order[I]];
+        if(!IsSpriteOnScreen(Info)) {
+            continue;
+        }
+        int32_t FirstBin = Info->DrawStartX / SPRITE_BIN_WIDTH;
+        int32_t LastBin = (Info->DrawEndX - 1) / SPRITE_BIN_WIDTH;
+        for(int32_t BinI = FirstBin; BinI <= LastBin; BinI++) {
+            Bins->Start[BinI + 1]++;
+        }
+    }
+
+    /*PrefixSum*/
+    uint32_t Cursor[MAX_SPRITE_BINS];
+    for(int32_t BinI = 0; BinI < BinCount; BinI++) {
+        Bins->Start[BinI + 1] += Bins->Start[BinI];
+        Cursor[BinI] = Bins->Start[BinI];
+    }
+    if(!ReserveSpriteBins(Bins, Bins->Start[BinCount])) {
+        memset(Bins->Start, 0, (BinCount + 1) * sizeof(*Bins->Start));
+        return;
+    }
+
+    /*FillBins*/
+    for(uint32_t I = 0; I < Sprites->VisibleCount; I++) {
+        uint32_t SpriteI = Sprites->Order[I];
+        const sprite_render_info *Info = &Sprites->Infos[SpriteI];
+        if(!IsSpriteOnScreen(Info)) {
+            continue;
+        }
+        int32_t FirstBin = Info->DrawStartX / SPRITE_BIN_WIDTH;
+        int32_t LastBin = (Info->DrawEndX - 1) / SPRITE_BIN_WIDTH;
+        for(int32_t BinI = FirstBin; BinI <= LastBin; BinI++) {
+            Bins->Items[Cursor[BinI]++] = SpriteI;
+        }
+    }
+}
+
+/*
+ * Also lists the sprites that survive culling in Order, keyed on their
+ * depth quantized over the distance the fog leaves visible
+ */
+static void ComputeRenderSpriteInfos(game_state *GS) {
+    sprite_tables *Sprites = &GS->Tables->Sprites;
+    sprite_render_info *SpriteRenderInfos = Sprites->Infos;
+    float KeyScale = 65535.0F / GS->FogHorizon;
+    uint32_t VisibleCount = 0;
+    const render_view *View = &GS->View;
+
+    int32_t BobCycle = (int32_t) (View->TotalTime * 16) % 16;
     int32_t Bob = BobCycle < 8 ? BobCycle : 16 - BobCycle; 
+    int32_t Width = GS->Scene.Width;
+    int32_t Height = GS->Scene.Height;
 
-    for(uint32_t I = 0; I < GS->SpriteCount; I++) {
-        vec2 SpriteDis = SubVec2(GS->Sprites[I].Pos, GS->Pos);
-        float InvDet = 1.0F / DetVec2(GS->Plane, GS->Dir);
-        float TransformX = InvDet * DetVec2(SpriteDis, GS->Dir);
-        float TransformY = InvDet * DetVec2(GS->Plane, SpriteDis);
+    float InvDet = 1.0F / DetVec2(View->Plane, View->Dir);
+    for(uint32_t I = 0; I < View->SpriteCount; I++) {
+        vec2 SpriteDis = SubVec2(View->Sprites[I].Pos, View->Pos);
+        float TransformY = InvDet * DetVec2(View->Plane, SpriteDis);
+
+        /*CullBeforeProjecting*/
+        if(TransformY < SPRITE_NEAR_DIST || TransformY >= GS->FogHorizon) {
+            SpriteRenderInfos[I] = (sprite_render_info) {};
+            continue;
+        }
+        Sprites->Keys[I] = (uint16_t) (TransformY * KeyScale);
+        Sprites->Order[VisibleCount++] = I;
+
+        uint8_t FogLevel = CalcFogLevel(GS->FogLevels, TransformY);
+        float TransformX = InvDet * DetVec2(SpriteDis, View->Dir);
 
         int32_t SpriteScreenX = (int) (
-            (float) DIB_WIDTH / 2.0F * 
+            (float) Width / 2.0F * 
             (1.0F + TransformX / TransformY)
         );
 
@@ -96,29 +261,28 @@ static void ComputeRenderSpriteInfos(
         float VMove = Bob;
         int32_t VMoveScreen = (int) (VMove / TransformY);
 
-        /*UseFogEffect*/
-        float PerpDist = TransformY;
-        if(PerpDist > 5.0F) {
-            continue;
-        }
-        float FogEffect = CalcFogEffect(TransformY);
-
         /*CalcYCompVars*/
-        int32_t SpriteHeight = ABS((int32_t) (DIB_HEIGHT / TransformY)) / VDiv;
-        int32_t DrawStartY = MAX(0, (DIB_HEIGHT - SpriteHeight) / 2 + VMoveScreen); 
-        int32_t DrawEndY = MIN(DIB_HEIGHT - 1, (SpriteHeight + DIB_HEIGHT) / 2 + VMoveScreen); 
+        int32_t SpriteHeight = ABS((int32_t) (Height / TransformY)) / VDiv;
+        int32_t DrawStartY = MAX(
+            0, 
+            (Height - SpriteHeight) / 2 + VMoveScreen
+        ); 
+        int32_t DrawEndY = MIN(
+            Height - 1, 
+            (SpriteHeight + Height) / 2 + VMoveScreen
+        ); 
                     
         /*CalcXCompXVars*/
-        int32_t SpriteWidth = ABS((int32_t) (DIB_HEIGHT / TransformY)) / UDiv;
+        int32_t SpriteWidth = ABS((int32_t) (Height / TransformY)) / UDiv;
         int32_t DrawStartX = MAX(0, SpriteScreenX - SpriteWidth / 2);
-        int32_t DrawEndX = MIN(DIB_WIDTH, SpriteWidth / 2 + SpriteScreenX);
+        int32_t DrawEndX = MIN(Width, SpriteWidth / 2 + SpriteScreenX);
 
         SpriteRenderInfos[I] = (sprite_render_info) { 
             .TransformY = TransformY,
             .SpriteScreenX = SpriteScreenX,
             .SpriteWidth = SpriteWidth, 
             .SpriteHeight = SpriteHeight,
-            .FogEffect = FogEffect,
+            .FogLevel = FogLevel,
             .DrawStartX = DrawStartX,
             .DrawEndX = DrawEndX,
             .DrawStartY = DrawStartY,
@@ -126,258 +290,965 @@ static void ComputeRenderSpriteInfos(
             .VMoveScreen = VMoveScreen
         };
     }
+    Sprites->VisibleCount = VisibleCount;
 }
 
-static void RenderDecksTask(void *TaskData) {
-    render_decks_data *P = TaskData; 
-    for(int32_t FloorY = P->StartY; FloorY < P->EndY; FloorY++) {
-        /*CalcZCompVals*/
-        vec2 RayDir = SubVec2(P->GS->Dir, P->GS->Plane); 
-        int32_t Horizon = DIB_HEIGHT / 2 - FloorY;
-        float PosZ = 0.5F * DIB_HEIGHT;
-        float RowDis = PosZ / (float) Horizon;
-        float FogEffect = CalcFogEffect(RowDis);
-
-        /*CalcFloorStep*/
-        vec2 PlaneTwice = MulVec2(P->GS->Plane, 2); 
-        float UnitRowDis = RowDis / (float) DIB_WIDTH;
-        vec2 FloorStep = MulVec2(PlaneTwice, UnitRowDis);
-
-        /*CalcInitFloor*/
-        vec2 DeltaFloor = MulVec2(RayDir, RowDis); 
-        vec2 Floor = AddVec2(P->GS->Pos, DeltaFloor); 
-
-        for(int X = 0; X < DIB_WIDTH; X++) {
-            vec2 TexPos = MulVec2(RevTruncVec2(Floor), TEX_LENGTH); 
-            int32_t TexX = TexPos.X;
-            int32_t TexY = TexPos.Y;
-            
-            Floor = AddVec2(Floor, FloorStep);
-
-            P->GS->Pixels[FloorY][X] = MulColor(P->GS->TexData[1][TexY][TexX], FogEffect); 
-            int32_t CeilY = DIB_HEIGHT - FloorY - 1;
-            P->GS->Pixels[CeilY][X] = MulColor(P->GS->TexData[2][TexY][TexX], FogEffect / 2); 
-        } 
-    }
-}
-
-static void RenderSprite(render_facing_data *P, int X, const tile_hit *TileHit) {
-    sprite_render_info *RenderInfo = &P->SpriteRenderInfos[TileHit->SpriteI];
-
-    int TexX = (
-        256 * 
-        (X + RenderInfo->SpriteWidth / 2 - RenderInfo->SpriteScreenX) * 
-        TEX_LENGTH / 
-        (RenderInfo->SpriteWidth * 256) 
-    ); 
-
-    for(int Y = RenderInfo->DrawStartY; Y < RenderInfo->DrawEndY; Y++) {
-        int D = (
-            (Y - RenderInfo->VMoveScreen) * 256 + 
-            (RenderInfo->SpriteHeight - DIB_HEIGHT) * 128 
-        );
-        int32_t TexY = D * TEX_LENGTH / RenderInfo->SpriteHeight / 256; 
-        tile Texture = GetTileData(P->GS->Sprites[TileHit->SpriteI].Tile).TexI;
-        color Color = P->GS->TexData[Texture][TexY][TexX];
+static void FillBlack(int32_t Count, color Pixels[static Count]) {
+    for(int32_t I = 0; I < Count; I++) {
+        Pixels[I] = OpaqueColor(0, 0, 0);
+    }
+}
 
-        if(IsOpaque(Color)) {
-            P->GS->Pixels[Y][X] = MulColor(Color, RenderInfo->FogEffect);
+static void RenderDecksTask(
+    void *TaskData, 
+    int32_t JobI, 
+    [[maybe_unused]] int32_t WorkerI
+) {
+    render_decks_data *P = TaskData; 
+    frame_buffer *Scene = &P->GS->Scene;
+    const scene_tables *Rows = &P->GS->Tables->Scene;
+    const camera_tables *Deck = &P->GS->Tables->Camera;
+    int32_t StartY = JobI * DECK_JOB_ROWS;
+    int32_t EndY = MIN(StartY + DECK_JOB_ROWS, Scene->Height / 2);
+    for(int32_t FloorY = StartY; FloorY < EndY; FloorY++) {
+        int32_t CeilY = Scene->Height - FloorY - 1;
+        color *FloorRow = &Scene->Pixels[FloorY * Scene->Width];
+        color *CeilRow = &Scene->Pixels[CeilY * Scene->Width];
+        if(FloorY >= Rows->FogFloorY) {
+            FillBlack(Scene->Width, FloorRow);
+            FillBlack(Scene->Width, CeilRow);
+            continue;
         }
+
+        const shade_cache *Shades = P->GS->Shades;
+        int32_t MipBias = Rows->MipBias[FloorY];
+        texture FloorTex = GetShadedTexture(
+            Shades, 
+            Rows->Fog[FloorY], 
+            false, 
+            FLOOR_TEX_I
+        );
+        texture CeilTex = GetShadedTexture(
+            Shades, 
+            Rows->Fog[CeilY], 
+            false, 
+            CEIL_TEX_I
+        );
+        deck_span Span = {
+            .FloorTex = SelectMip(FloorTex, MipBias),
+            .CeilTex = SelectMip(CeilTex, MipBias),
+            .FloorRow = FloorRow,
+            .CeilRow = CeilRow,
+            .Count = Scene->Width,
+            .U = Deck->U[FloorY],
+            .V = Deck->V[FloorY],
+            .StepU = Deck->StepU[FloorY],
+            .StepV = Deck->StepV[FloorY]
+        };
+        P->Kernel(&Span);
     }
 }
 
-static void RenderFacingTask(void *TaskData) {
-    render_facing_data *P = TaskData; 
-    for(int32_t X = P->StartX; X < P->EndX; X++) {
-        float CameraX = (float) (X << 1) / (float) DIB_WIDTH - 1;
-
-        /*CalcXCompVars*/
-        float RayDirX = P->GS->Dir.X + P->GS->Plane.X * CameraX;
-        float DeltaDistX = ABS(1.0F / RayDirX);
-        int32_t TileX = (int32_t) P->GS->Pos.X;
-        int32_t StepX;
-        float SideDistX;
-        if(RayDirX < 0.0F) {
-            StepX = -1;
-            SideDistX = (P->GS->Pos.X - TileX) * DeltaDistX;
-        } else {
-            StepX = 1;
-            SideDistX = (TileX + 1.0F - P->GS->Pos.X) * DeltaDistX;
+/*
+ * Draws a sprite as a rectangle clipped to the block's columns. A texel
+ * is kept only where it is opaque and nearer than what Depth holds, so on
+ * equal distances the sprite drawn first stays in front. Texels step in
+ * 16.16 fixed point across and down the sprite.
+ */
+static void RenderSprite(
+    render_facing_data *P,
+    int32_t SpriteI,
+    int32_t BlockX,
+    int32_t BlockWidth,
+    const facing_column Columns[static FACING_BLOCK],
+    color Scratch[static FACING_BLOCK][MAX_DIB_HEIGHT],
+    float Depth[static FACING_BLOCK][MAX_DIB_HEIGHT]
+) {
+    const sprite_render_info *RenderInfo = &P->SpriteRenderInfos[SpriteI];
+    const scene_tables *Scene = &P->GS->Tables->Scene;
+    float Dis = RenderInfo->TransformY;
+    line_step LineX = GetLineStep(Scene, RenderInfo->SpriteWidth);
+    line_step LineY = GetLineStep(Scene, RenderInfo->SpriteHeight);
+    tile Texture = GetTileData(P->GS->View.Sprites[SpriteI].Tile).TexI;
+    texture FullTex = GetShadedTexture(
+        P->GS->Shades, 
+        RenderInfo->FogLevel, 
+        false, 
+        Texture
+    );
+    texture Tex = SelectMip(FullTex, MAX(LineX.MipBias, LineY.MipBias));
+    int32_t StartX = MAX(RenderInfo->DrawStartX, BlockX);
+    int32_t EndX = MIN(RenderInfo->DrawEndX, BlockX + BlockWidth);
+
+    /*StepAcrossFromTheLeftEdge*/
+    uint32_t StepX = GetTexStep(LineX, Tex.Log2Length);
+    int32_t LeftX = RenderInfo->SpriteScreenX - RenderInfo->SpriteWidth / 2;
+    uint32_t TexPosX = (uint32_t) (StartX - LeftX) * StepX;
+
+    /*TheTopEdgeCanFallHalfwayThroughARowSoCountInHalfRows*/
+    uint32_t StepY = GetTexStep(LineY, Tex.Log2Length);
+    int32_t FirstHalfRows = (
+        2 * (RenderInfo->DrawStartY - RenderInfo->VMoveScreen) - 
+        (Scene->Height - RenderInfo->SpriteHeight)
+    );
+    uint32_t StartTexPosY = (uint32_t) MAX(FirstHalfRows, 0) * StepY / 2;
+
+    for(int32_t X = StartX; X < EndX; X++, TexPosX += StepX) {
+        if(Dis >= Columns[X - BlockX].Depth) {
+            /*HiddenBehindTheWall*/
+            continue;
         }
+        color *Column = Scratch[X - BlockX];
+        float *ColumnDepth = Depth[X - BlockX];
+        uint32_t TexX = TexPosX >> LINE_STEP_SHIFT;
+        uint32_t TexXBits = SpreadTexBits(TexX) << 1;
 
-        /*CalcYCompVars*/
-        float RayDirY = P->GS->Dir.Y + P->GS->Plane.Y * CameraX;
-        float DeltaDistY = ABS(1.0F / RayDirY);
-        int32_t TileY = (int32_t) P->GS->Pos.Y;
-        int32_t StepY;
-        float SideDistY;
-        if(RayDirY < 0.0F) {
-            StepY = -1;
-            SideDistY = (P->GS->Pos.Y - TileY) * DeltaDistY;
-        } else {
-            StepY = 1;
-            SideDistY = (TileY + 1.0F - P->GS->Pos.Y) * DeltaDistY;
+        uint32_t TexPosY = StartTexPosY;
+        for(int Y = RenderInfo->DrawStartY; Y < RenderInfo->DrawEndY; Y++) {
+            uint32_t TexY = TexPosY >> LINE_STEP_SHIFT;
+            TexPosY += StepY;
+            if(Dis >= ColumnDepth[Y]) {
+                continue;
+            }
+            color Color = Tex.Texels[TexXBits | SpreadTexBits(TexY)];
+
+            if(IsOpaque(Color)) {
+                Column[Y] = Color;
+                ColumnDepth[Y] = Dis;
+            }
         }
+    }
+}
 
-        /*LocateTileHit*/
-        tile_hit TileHits[MAX_TILE_HITS];
-        int32_t TileHitCount = 0;
+static bool IsWallDrawn(const tile_hit *TileHit, bool IsLast) {
+    return (
+        (TileHit->TileData.TexI != 0 || IsLast) &&
+        (TileHit->TileData.Flags & TF_VERT || !TileHit->Side) &&
+        (TileHit->TileData.Flags & TF_HORZ || TileHit->Side)
+    );
+}
 
-        TileHits[TileHitCount++] = (tile_hit) {
-            .SpriteI = -1
-        };
-        if(IsInTileMap(TileY, TileX)) {
-            TileHits[0].TileData = GetTileData(P->GS->TileMap[TileY][TileX]);
-            while(TileHitCount < MAX_TILE_HITS) {
-                tile_hit *TileHitCur = &TileHits[TileHitCount];
-                if(SideDistX < SideDistY) {
-                    SideDistX += DeltaDistX;
-                    TileX += StepX;
-                    TileHitCur->Side = false;
-                    TileHitCur->PerpWallDist = SideDistX - DeltaDistX;
-                } else {
-                    SideDistY += DeltaDistY;
-                    TileY += StepY;
-                    TileHitCur->PerpWallDist = SideDistY - DeltaDistY;
-                    TileHitCur->Side = true;
-                }
-                TileHitCur->SpriteI = -1;
-                if(!IsInTileMap(TileY, TileX)) {
-                    break;
-                }
-                TileHitCur->TileData = GetTileData(P->GS->TileMap[TileY][TileX]);
-                TileHitCount++;
-
-                if(!(TileHitCur->TileData.Flags & TF_ALPHA)) {
-                    break;
-                }
+/*A ray's last hit is drawn even when empty, unless the ray hit the fog*/
+static bool IsForcedHit(const facing_column *Column, int32_t TileI) {
+    return TileI == Column->TileHitCount - 1 && !Column->FogStop;
+}
+
+static wall_span CalcWallSpan(int32_t Height, float PerpWallDist) {
+    int32_t LineHeight = (int32_t) (Height / PerpWallDist);
+    int32_t HalfHeight = LineHeight / 2;
+
+    int32_t DrawCenter = Height / 2;
+    return (wall_span) {
+        .LineHeight = LineHeight,
+        .DrawStart = MAX(0, DrawCenter - HalfHeight),
+        .DrawEnd = MIN(Height - 1, DrawCenter + HalfHeight)
+    };
+}
+
+static ray_walk CreateRayWalk(
+    vec2 Pos, 
+    float RayDirX, 
+    float RayDirY, 
+    float DeltaX, 
+    float DeltaY
+) {
+    ray_walk Walk = {
+        .TileX = (int32_t) Pos.X,
+        .TileY = (int32_t) Pos.Y,
+        .DeltaX = DeltaX,
+        .DeltaY = DeltaY
+    };
+    if(RayDirX < 0.0F) {
+        Walk.StepX = -1;
+        Walk.BaseX = (Pos.X - Walk.TileX) * DeltaX;
+    } else {
+        Walk.StepX = 1;
+        Walk.BaseX = (Walk.TileX + 1.0F - Pos.X) * DeltaX;
+    }
+    if(RayDirY < 0.0F) {
+        Walk.StepY = -1;
+        Walk.BaseY = (Pos.Y - Walk.TileY) * DeltaY;
+    } else {
+        Walk.StepY = 1;
+        Walk.BaseY = (Walk.TileY + 1.0F - Pos.Y) * DeltaY;
+    }
+    Walk.NextX = Walk.BaseX;
+    Walk.NextY = Walk.BaseY;
+    return Walk;
+}
+
+/*Takes the nearer crossing, Y on a tie, and returns its distance*/
+static float StepRayWalk(ray_walk *Walk, bool *Side) {
+    float Dist;
+    if(Walk->NextX < Walk->NextY) {
+        Dist = Walk->NextX;
+        Walk->TileX += Walk->StepX;
+        Walk->CountX++;
+        Walk->NextX = CalcCrossing(Walk->BaseX, Walk->DeltaX, Walk->CountX);
+        *Side = false;
+    } else {
+        Dist = Walk->NextY;
+        Walk->TileY += Walk->StepY;
+        Walk->CountY++;
+        Walk->NextY = CalcCrossing(Walk->BaseY, Walk->DeltaY, Walk->CountY);
+        *Side = true;
+    }
+    return Dist;
+}
+
+static bool IsCrossingTaken(
+    float Base, 
+    float Delta, 
+    int32_t Count, 
+    float Limit, 
+    bool IsTieTaken
+) {
+    float Crossing = CalcCrossing(Base, Delta, Count);
+    return IsTieTaken ? Crossing <= Limit : Crossing < Limit;
+}
+
+/*
+ * First count from From up to From + Reach whose crossing is not taken
+ * before Limit. A crossing on Limit is taken only when IsTieTaken. Starts
+ * from a division estimate and corrects it against the exact crossings.
+ */
+static int32_t FindCrossingCount(
+    float Base, 
+    float Delta, 
+    int32_t From, 
+    int32_t Reach, 
+    float Limit, 
+    bool IsTieTaken
+) {
+    float Estimate = (Limit - Base) / Delta;
+    int32_t Count = From;
+    if(Estimate >= (float) (From + Reach)) {
+        Count = From + Reach;
+    } else if(Estimate > (float) From) {
+        Count = (int32_t) Estimate;
+    }
+    while(
+        Count > From && 
+        !IsCrossingTaken(Base, Delta, Count - 1, Limit, IsTieTaken)
+    ) {
+        Count--;
+    }
+    while(
+        Count < From + Reach && 
+        IsCrossingTaken(Base, Delta, Count, Limit, IsTieTaken)
+    ) {
+        Count++;
+    }
+    return Count;
+}
+
+/*
+ * Every cell up to Reach cells away on both axes is empty, so the walk
+ * jumps to the last cell it would visit inside that square. Crossings are
+ * computed from their counts rather than summed, so the jump lands on the
+ * same cell and the same next crossings as stepping would.
+ */
+static void SkipEmptyCells(ray_walk *Walk, int32_t Reach) {
+    int32_t CountX = Walk->CountX;
+    int32_t CountY = Walk->CountY;
+    float ExitX = CalcCrossing(Walk->BaseX, Walk->DeltaX, CountX + Reach);
+    float ExitY = CalcCrossing(Walk->BaseY, Walk->DeltaY, CountY + Reach);
+    if(ExitX < ExitY) {
+        Walk->CountX = CountX + Reach;
+        Walk->CountY = FindCrossingCount(
+            Walk->BaseY, Walk->DeltaY, CountY, Reach, ExitX, true
+        );
+    } else {
+        Walk->CountY = CountY + Reach;
+        Walk->CountX = FindCrossingCount(
+            Walk->BaseX, Walk->DeltaX, CountX, Reach, ExitY, false
+        );
+    }
+    Walk->TileX += Walk->StepX * (Walk->CountX - CountX);
+    Walk->TileY += Walk->StepY * (Walk->CountY - CountY);
+    Walk->NextX = CalcCrossing(Walk->BaseX, Walk->DeltaX, Walk->CountX);
+    Walk->NextY = CalcCrossing(Walk->BaseY, Walk->DeltaY, Walk->CountY);
+}
+
+/*Walk may already be part way along, as long as it only passed empty cells*/
+static void CastFacingColumn(
+    render_facing_data *P, 
+    int32_t X, 
+    ray_walk Walk,
+    facing_column *Column
+) {
+    tile_hit *TileHits = Column->TileHits;
+    int32_t Height = P->GS->Scene.Height;
+    const camera_tables *Rays = &P->GS->Tables->Camera;
+    float RayDirX = Rays->RayDirX[X];
+    float RayDirY = Rays->RayDirY[X];
+    int32_t StartX = (int32_t) P->GS->View.Pos.X;
+    int32_t StartY = (int32_t) P->GS->View.Pos.Y;
+
+    /*LocateTileHit*/
+    int32_t TileHitCount = 0;
+    bool FogStop = false;
+
+    /*
+     * The border stops every ray before it leaves the map. Empty cells
+     * are never drawn or layered, so only the cells that stop the ray or
+     * hold something are kept as hits. Runs of empty cells around the
+     * ray are skipped with the map's empty radii. A skip may pass the fog
+     * horizon, but it passes no hits, so the next step still stops there.
+     */
+    const tile_map *Map = &P->GS->TileMap;
+    TileHits[TileHitCount++] = (tile_hit) {};
+    if(IsInTileMap(Map, StartX, StartY)) {
+        TileHits[0].TileData = GetTileData(GetTile(Map, StartX, StartY));
+        while(TileHitCount < MAX_TILE_HITS) {
+            int32_t Reach = GetEmptyRadius(Map, Walk.TileX, Walk.TileY) - 1;
+            if(Reach >= MIN_SKIP_REACH) {
+                SkipEmptyCells(&Walk, Reach);
+            }
+
+            tile_hit *TileHitCur = &TileHits[TileHitCount];
+            TileHitCur->PerpWallDist = StepRayWalk(&Walk, &TileHitCur->Side);
+            if(TileHitCur->PerpWallDist >= P->GS->FogHorizon) {
+                FogStop = true;
+                break;
+            }
+
+            bool IsStop = IsTileStop(Map, Walk.TileX, Walk.TileY);
+            tile Tile = GetTile(Map, Walk.TileX, Walk.TileY);
+            if(!IsStop && Tile == TD_NONE) {
+                continue;
             }
+            TileHitCur->TileData = GetTileData(Tile);
+            TileHitCount++;
+            if(IsStop) {
+                break;
+            }
+        }
+    }
+    Column->FogStop = FogStop;
+    Column->TileHitCount = TileHitCount;
+
+    /*FindRowBand*/
+    int32_t DrawStart = Height;
+    int32_t DrawEnd = 0;
+    for(int32_t TileI = 0; TileI < TileHitCount; TileI++) {
+        tile_hit *TileHitCur = &TileHits[TileI];
+        if(IsWallDrawn(TileHitCur, IsForcedHit(Column, TileI))) {
+            wall_span Span = CalcWallSpan(Height, TileHitCur->PerpWallDist);
+            DrawStart = MIN(DrawStart, Span.DrawStart);
+            DrawEnd = MAX(DrawEnd, Span.DrawEnd);
+        }
+    }
+
+    /*FindSpriteRows*/
+    float Depth = (
+        FogStop ? INFINITY : TileHits[TileHitCount - 1].PerpWallDist
+    );
+    int32_t SpriteStart = Height;
+    int32_t SpriteEnd = 0;
+    const sprite_bins *Bins = &P->GS->Tables->SpriteBins;
+    int32_t BinI = X / SPRITE_BIN_WIDTH;
+    for(uint32_t K = Bins->Start[BinI]; K < Bins->Start[BinI + 1]; K++) { 
+        const sprite_render_info *RenderInfo = (
+            &P->SpriteRenderInfos[Bins->Items[K]]
+        );
+        if(
+            RenderInfo->DrawStartX > X ||
+            RenderInfo->DrawEndX <= X ||
+            RenderInfo->TransformY >= Depth
+        ) {
+            continue;
         }
+        SpriteStart = MIN(SpriteStart, RenderInfo->DrawStartY);
+        SpriteEnd = MAX(SpriteEnd, RenderInfo->DrawEndY);
+    }
+
+    Column->RayDirX = RayDirX;
+    Column->RayDirY = RayDirY;
+    Column->Depth = Depth;
+    Column->SpriteStart = SpriteStart;
+    Column->SpriteEnd = SpriteEnd;
+    Column->DrawStart = MIN(DrawStart, SpriteStart);
+    Column->DrawEnd = MAX(DrawEnd, SpriteEnd);
+}
+
+/*Layers Texels[Start] up to Texels[End] over the same rows of Pixels*/
+static void LayerWallRun(
+    render_facing_data *P,
+    int32_t Start,
+    int32_t End,
+    bool LayeredColor,
+    bool Side,
+    const color *Texels,
+    color *Pixels
+) {
+    if(Start >= End) {
+        return;
+    }
+    if(!LayeredColor) {
+        FillBlack(End - Start, &Pixels[Start]);
+    }
+    P->LayerKernel(End - Start, &Pixels[Start], &Texels[Start], Side);
+}
+
+/*
+ * With Depth set, pixels where a sprite nearer than the wall was drawn
+ * are left alone, so the sprite stays in front. Texels come pre-shaded
+ * from the shade cache. Walls without TF_ALPHA are opaque and store them
+ * as fetched. See-through walls collect them and layer each run of rows
+ * no sprite covers in one go.
+ */
+static void DrawWall(
+    render_facing_data *P, 
+    const facing_column *Column,
+    int32_t TileI,
+    bool LayeredColor,
+    const float *Depth,
+    color *Pixels
+) {
+    const tile_hit *TileHitCur = &Column->TileHits[TileI];
+    float RayDirX = Column->RayDirX;
+    float RayDirY = Column->RayDirY;
+    int32_t Height = P->GS->Scene.Height;
+    float Dis = TileHitCur->PerpWallDist;
+    bool Side = TileHitCur->Side;
+    bool IsAlpha = TileHitCur->TileData.Flags & TF_ALPHA;
+
+    /*FindWall*/
+    uint8_t FogLevel = CalcFogLevel(P->GS->FogLevels, Dis);
+    float WallX = (
+        Side ?
+            P->GS->View.Pos.X + Dis * RayDirX :
+            P->GS->View.Pos.Y + Dis * RayDirY 
+    );
+    WallX -= floorf(WallX);
+
+    /*FindTexture*/
+    wall_span Span = CalcWallSpan(Height, Dis);
+    line_step Line = GetLineStep(&P->GS->Tables->Scene, Span.LineHeight);
+    /*LayeringDarkensAfterwardsSoItTakesThePlainCopy*/
+    texture FullTex = GetShadedTexture(
+        P->GS->Shades, 
+        FogLevel, 
+        Side && !IsAlpha, 
+        TileHitCur->TileData.TexI
+    );
+    texture Tex = SelectMip(FullTex, Line.MipBias);
+    int32_t TexLength = GetTexLength(&Tex);
+    int32_t TexX = (int) (WallX * (float) TexLength); 
+    if(Side ? RayDirY < 0.0 : RayDirX > 0.0) {
+        TexX = TexLength - TexX - 1; 
+    }
+    const color *TexColumn = &Tex.Texels[SpreadTexBits(TexX) << 1];
+
+    /*RenderLine*/
+    uint32_t TexStep = GetTexStep(Line, Tex.Log2Length);
+    uint32_t TexPos = (uint32_t) Line.HiddenRows * TexStep;
 
-        for(uint32_t I = 0; I < P->GS->SpriteCount && TileHitCount < MAX_TILE_HITS; I++) { 
-            if(
-                P->SpriteRenderInfos[I].TransformY <= 0.0F || 
-                P->SpriteRenderInfos[I].DrawStartX > X ||
-                P->SpriteRenderInfos[I].DrawEndX <= X
-            ) {
+    int32_t SpriteStart = Depth ? Column->SpriteStart : Height;
+    int32_t SpriteEnd = Depth ? Column->SpriteEnd : 0;
+    if(!IsAlpha) {
+        for(int32_t Y = Span.DrawStart; Y < Span.DrawEnd; Y++) {
+            uint32_t TexY = TexPos >> LINE_STEP_SHIFT & (TexLength - 1);
+            TexPos += TexStep;
+            if(Y >= SpriteStart && Y < SpriteEnd && Depth[Y] < Dis) {
                 continue;
             }
+            Pixels[Y] = TexColumn[SpreadTexBits(TexY)];
+        }
+        return;
+    }
+
+    color Texels[MAX_DIB_HEIGHT];
+    int32_t RunStart = Span.DrawStart;
+    for(int32_t Y = Span.DrawStart; Y < Span.DrawEnd; Y++) {
+        uint32_t TexY = TexPos >> LINE_STEP_SHIFT & (TexLength - 1);
+        TexPos += TexStep;
+        Texels[Y] = TexColumn[SpreadTexBits(TexY)];
+        if(Y >= SpriteStart && Y < SpriteEnd && Depth[Y] < Dis) {
+            LayerWallRun(P, RunStart, Y, LayeredColor, Side, Texels, Pixels);
+            RunStart = Y + 1;
+        }
+    }
+    LayerWallRun(
+        P, 
+        RunStart, 
+        Span.DrawEnd, 
+        LayeredColor, 
+        Side, 
+        Texels, 
+        Pixels
+    );
+}
+
+/*
+ * The wall a ray stopped at hides every sprite behind it, so it is drawn
+ * before the sprites. A ray that hit the fog has no such wall.
+ */
+static void DrawFarWall(
+    render_facing_data *P, 
+    const facing_column *Column,
+    color *Pixels
+) {
+    int32_t LastI = Column->TileHitCount - 1;
+    if(!Column->FogStop && IsWallDrawn(&Column->TileHits[LastI], true)) {
+        DrawWall(P, Column, LastI, false, NULL, Pixels);
+    }
+}
+
+/*
+ * The see-through walls in front of the far wall are layered after the
+ * sprites, farthest first. With the fog behind them they are layered
+ * over the decks, which carry on past the walls into the fog.
+ */
+static void DrawNearWalls(
+    render_facing_data *P, 
+    const facing_column *Column,
+    const float *Depth,
+    color *Pixels
+) {
+    int32_t LastI = Column->TileHitCount - 1;
+    int32_t TileI = Column->FogStop ? LastI + 1 : LastI; 
+    while(TileI-- > 0) {
+        const tile_hit *TileHitCur = &Column->TileHits[TileI];
+        if(IsWallDrawn(TileHitCur, IsForcedHit(Column, TileI))) {
+            DrawWall(P, Column, TileI, true, Depth, Pixels);
+        }
+    }
+}
+
+/*
+ * The wall a ray stopped at is drawn first and layered over black, so
+ * nothing under its span shows through and the decks only need the rows
+ * outside. Rows past the fog are filled black without sampling.
+ */
+static void FillDeckColumn(
+    render_facing_data *P, 
+    int32_t X, 
+    const facing_column *Column,
+    color *Pixels
+) {
+    int32_t Height = P->GS->Scene.Height;
+    wall_span Hidden = {
+        .DrawStart = Height / 2,
+        .DrawEnd = Height / 2
+    };
+    int32_t LastI = Column->TileHitCount - 1;
+    const tile_hit *Last = &Column->TileHits[LastI];
+    if(!Column->FogStop && IsWallDrawn(Last, true)) {
+        Hidden = CalcWallSpan(Height, Last->PerpWallDist);
+    }
+
+    const scene_tables *Rows = &P->GS->Tables->Scene;
+    const camera_tables *Deck = &P->GS->Tables->Camera;
+    /*RowShadeMovesTheBlackCopiesToEachRowsLevelAndMip*/
+    const shade_cache *Shades = P->GS->Shades;
+    deck_column Floor = {
+        .Tex = GetShadedTexture(Shades, 0, false, FLOOR_TEX_I),
+        .RowU = Deck->U,
+        .RowV = Deck->V,
+        .RowStepU = Deck->StepU,
+        .RowStepV = Deck->StepV,
+        .RowShade = Rows->Shade,
+        .RowShift = Rows->TexShift,
+        .Pixels = Pixels,
+        .X = X,
+        .Start = 0,
+        .End = MIN(Hidden.DrawStart, Rows->FogFloorY)
+    };
+    P->DeckKernel(&Floor);
+    FillBlack(Hidden.DrawStart - Floor.End, &Pixels[Floor.End]);
+
+    int32_t FogCeilEnd = MAX(Hidden.DrawEnd, Height - Rows->FogFloorY);
+    FillBlack(FogCeilEnd - Hidden.DrawEnd, &Pixels[Hidden.DrawEnd]);
+    deck_column Ceil = Floor;
+    Ceil.Tex = GetShadedTexture(Shades, 0, false, CEIL_TEX_I);
+    Ceil.Start = FogCeilEnd;
+    Ceil.End = Height;
+    P->DeckKernel(&Ceil);
+}
+
+/*
+ * Adjacent rays mostly cross the same empty cells, so the block's rays
+ * first walk together as a packet up to the first hit or fog any of them
+ * meets, then each finishes on its own from where the packet left it.
+ */
+static void CastFacingBlock(
+    render_facing_data *P, 
+    int32_t BlockX,
+    int32_t BlockWidth,
+    facing_column Columns[static FACING_BLOCK]
+) {
+    const camera_tables *Rays = &P->GS->Tables->Camera;
+    const tile_map *Map = &P->GS->TileMap;
+    vec2 Pos = P->GS->View.Pos;
+    ray_walk Walks[FACING_BLOCK];
+    for(int32_t I = 0; I < BlockWidth; I++) {
+        int32_t X = BlockX + I;
+        Walks[I] = CreateRayWalk(
+            Pos, 
+            Rays->RayDirX[X], 
+            Rays->RayDirY[X], 
+            Rays->DeltaDistX[X], 
+            Rays->DeltaDistY[X]
+        );
+    }
+    if(IsInTileMap(Map, (int32_t) Pos.X, (int32_t) Pos.Y)) {
+        P->RayKernel(Map, P->GS->FogHorizon, BlockWidth, Walks);
+    }
+    for(int32_t I = 0; I < BlockWidth; I++) {
+        CastFacingColumn(P, BlockX + I, Walks[I], &Columns[I]);
+    }
+}
 
-            tile_hit NewTileHit = {
-                .PerpWallDist = P->SpriteRenderInfos[I].TransformY,
-                .TileData = GetTileData(P->GS->Sprites[I].Tile), 
-                .SpriteI = I,
-            };
-
-            /*InsertTileHit*/
-            for(int32_t J = 0; J < TileHitCount; J++) {
-                if(NewTileHit.PerpWallDist < TileHits[J].PerpWallDist) {
-                    memmove(&TileHits[J + 1], &TileHits[J], (TileHitCount - J) * sizeof(*TileHits));
-                    TileHits[J] = NewTileHit; 
-                    TileHitCount++;
-                    break;
-                }
-            } 
-        } 
-
-        int32_t TileI = TileHitCount; 
-        bool LayeredColor = false;
-        while(TileI-- > 0) {
-            tile_hit *TileHitCur = &TileHits[TileI];
-
-            if(TileHitCur->SpriteI >= 0) {
-                RenderSprite(P, X, TileHitCur);
-            } else if(
-                (TileHitCur->TileData.TexI != 0 || TileI == TileHitCount - 1) &&
-                (TileHitCur->TileData.Flags & TF_VERT || !TileHitCur->Side) &&
-                (TileHitCur->TileData.Flags & TF_HORZ || TileHitCur->Side)
-            ) {
-                /*FindWall*/
-                float FogEffect = CalcFogEffect(TileHitCur->PerpWallDist);
-                float WallX = (
-                    TileHitCur->Side ?
-                        P->GS->Pos.X + TileHitCur->PerpWallDist * RayDirX :
-                        P->GS->Pos.Y + TileHitCur->PerpWallDist * RayDirY 
-                );
-                WallX -= floorf(WallX);
-
-                /*FindTexture*/
-                int32_t TexX = (int) (WallX * (float) TEX_LENGTH); 
-                if(TileHitCur->Side ? RayDirY < 0.0 : RayDirX > 0.0) {
-                    TexX = TEX_LENGTH - TexX - 1; 
-                }
-
-                /*RenderLine*/
-                int32_t LineHeight = (int32_t) (DIB_HEIGHT / TileHitCur->PerpWallDist);
-                int32_t HalfHeight = LineHeight / 2;
-
-                int32_t DrawCenter = DIB_HEIGHT / 2;
-                int32_t DrawStart = MAX(0, DrawCenter - HalfHeight);
-                int32_t DrawEnd = MIN(DIB_HEIGHT - 1, DrawCenter + HalfHeight);
-
-                float Step = (float) TEX_LENGTH / (DIB_HEIGHT / TileHitCur->PerpWallDist);
-                float TexPos = (float) (DrawStart - DrawCenter + HalfHeight) * Step; 
-
-                for(int32_t Y = DrawStart; Y < DrawEnd; Y++) {
-                    int32_t TexY = (int32_t) TexPos & (TEX_LENGTH - 1);
-                    TexPos += Step;
-                    color TexColor = P->GS->TexData[TileHitCur->TileData.TexI][TexY][TexX]; 
-                    color OutColor = MulColor(TexColor, FogEffect);
-                    if(TileHitCur->TileData.Flags | TF_ALPHA) {
-                        color ToLayerColor = LayeredColor ? P->GS->Pixels[Y][X] : OpaqueColor(0, 0, 0);
-                        OutColor = LayerColor(ToLayerColor, OutColor); 
-                    }
-                    if(TileHitCur->Side) {
-                        OutColor = HalfColor(OutColor);
-                    }
-                    P->GS->Pixels[Y][X] = OutColor;
-                }
+/*
+ * Sprites are drawn with every column of the block at once, so a block
+ * must sit inside one sprite bin and one job
+ */
+_Static_assert(
+    SPRITE_BIN_WIDTH % FACING_BLOCK == 0 && 
+    FACING_JOB_COLS % FACING_BLOCK == 0,
+    "Facing blocks must not straddle sprite bins"
+);
+
+/*
+ * Depth holds, per pixel of the rows a column's sprites cover, the
+ * distance of the nearest sprite drawn there, starting from the distance
+ * that hides sprites.
+ */
+static void RenderBlockSprites(
+    render_facing_data *P, 
+    int32_t BlockX,
+    int32_t BlockWidth,
+    const facing_column Columns[static FACING_BLOCK],
+    color Scratch[static FACING_BLOCK][MAX_DIB_HEIGHT],
+    float Depth[static FACING_BLOCK][MAX_DIB_HEIGHT]
+) {
+    bool HasSprites = false;
+    for(int32_t I = 0; I < BlockWidth; I++) {
+        const facing_column *Column = &Columns[I];
+        for(int32_t Y = Column->SpriteStart; Y < Column->SpriteEnd; Y++) {
+            Depth[I][Y] = Column->Depth;
+        }
+        HasSprites |= Column->SpriteStart < Column->SpriteEnd;
+    }
+    if(!HasSprites) {
+        return;
+    }
+
+    const sprite_bins *Bins = &P->GS->Tables->SpriteBins;
+    int32_t BinI = BlockX / SPRITE_BIN_WIDTH;
+    for(uint32_t K = Bins->Start[BinI]; K < Bins->Start[BinI + 1]; K++) { 
+        RenderSprite(
+            P, 
+            Bins->Items[K], 
+            BlockX, 
+            BlockWidth, 
+            Columns, 
+            Scratch, 
+            Depth
+        );
+    }
+}
+
+/*
+ * Columns are cast and drawn FACING_BLOCK at a time into a column-major
+ * scratch block so each wall column walks contiguous memory. Only the band
+ * of rows the block touches is transposed in from and back out to Pixels.
+ * Walls that hide sprites go first, then the sprites, then the see-through
+ * walls in front of them.
+ */
+static void RenderFacingTask(
+    void *TaskData, 
+    int32_t JobI, 
+    [[maybe_unused]] int32_t WorkerI
+) {
+    render_facing_data *P = TaskData; 
+    frame_buffer *Scene = &P->GS->Scene;
+    int32_t StartX = JobI * FACING_JOB_COLS;
+    int32_t EndX = MIN(StartX + FACING_JOB_COLS, Scene->Width);
+    facing_column Columns[FACING_BLOCK];
+    color Scratch[FACING_BLOCK][MAX_DIB_HEIGHT];
+    float Depth[FACING_BLOCK][MAX_DIB_HEIGHT];
+
+    for(int32_t BlockX = StartX; BlockX < EndX; BlockX += FACING_BLOCK) {
+        int32_t BlockWidth = MIN(EndX - BlockX, FACING_BLOCK);
+
+        CastFacingBlock(P, BlockX, BlockWidth, Columns);
+        int32_t BandStart = Scene->Height;
+        int32_t BandEnd = 0;
+        for(int32_t I = 0; I < BlockWidth; I++) {
+            BandStart = MIN(BandStart, Columns[I].DrawStart);
+            BandEnd = MAX(BandEnd, Columns[I].DrawEnd);
+        }
+
+        if(P->FusedColumns) {
+            /*FusedColumnsWriteEveryRow*/
+            BandStart = 0;
+            BandEnd = Scene->Height;
+            for(int32_t I = 0; I < BlockWidth; I++) {
+                FillDeckColumn(P, BlockX + I, &Columns[I], Scratch[I]);
             }
-            LayeredColor = true;
+        } else if(BandStart < BandEnd) {
+            BandStart &= ~(FACING_BLOCK - 1);
+            TransposeColors(
+                BandEnd - BandStart,
+                BlockWidth,
+                &Scene->Pixels[BandStart * Scene->Width + BlockX],
+                Scene->Width,
+                &Scratch[0][BandStart],
+                MAX_DIB_HEIGHT
+            );
+        } else {
+            continue;
+        }
+
+        for(int32_t I = 0; I < BlockWidth; I++) {
+            DrawFarWall(P, &Columns[I], Scratch[I]);
+        }
+        RenderBlockSprites(P, BlockX, BlockWidth, Columns, Scratch, Depth);
+        for(int32_t I = 0; I < BlockWidth; I++) {
+            DrawNearWalls(P, &Columns[I], Depth[I], Scratch[I]);
         }
+        TransposeColors(
+            BlockWidth,
+            BandEnd - BandStart,
+            &Scratch[0][BandStart],
+            MAX_DIB_HEIGHT,
+            &Scene->Pixels[BandStart * Scene->Width + BlockX],
+            Scene->Width
+        );
     }
 }
 
-static void RenderDecks(game_state *GS) {
-    render_decks_data TaskData[_countof(GS->Workers)];
+static int32_t CountJobs(int32_t Count, int32_t PerJob) {
+    return (Count + PerJob - 1) / PerJob;
+}
 
-    for(size_t I = 0; I < _countof(TaskData); I++) {
-        TaskData[I] = (render_decks_data) {
-            .GS = GS,
-            .StartY = I * DIB_HEIGHT / _countof(TaskData) / 2, 
-            .EndY  = (I + 1) * DIB_HEIGHT / _countof(TaskData) / 2
-        };
+/*Camera tables, which the decks and walls of the frame read*/
+static void UpdateTablesTask(
+    void *TaskData, 
+    [[maybe_unused]] int32_t JobI, 
+    [[maybe_unused]] int32_t WorkerI
+) {
+    game_state *GS = TaskData;
+    UpdateRenderTables(GS->Tables, GS);
+}
 
-        GS->Workers[I].Data = &TaskData[I]; 
-        GS->Workers[I].Task = RenderDecksTask;
+static void ComputeSpriteInfosTask(
+    void *TaskData, 
+    [[maybe_unused]] int32_t JobI, 
+    [[maybe_unused]] int32_t WorkerI
+) {
+    ComputeRenderSpriteInfos(TaskData);
+}
+
+static void SortSpritesTask(
+    void *TaskData, 
+    [[maybe_unused]] int32_t JobI, 
+    [[maybe_unused]] int32_t WorkerI
+) {
+    game_state *GS = TaskData;
+
+    /*NearestFirstSoFartherTexelsFailTheDepthTest*/
+    SortSprites(&GS->Tables->Sprites);
+    BinSprites(GS, &GS->Tables->Sprites, &GS->Tables->SpriteBins);
+}
+
+static render_decks_data GetDecksData(game_state *GS) {
+    deck_span_kernel *Kernel = GetDeckSpanKernel(GS->Config.DeckKernel);
+    return (render_decks_data) {
+        .GS = GS,
+        .Kernel = Kernel ?: GetDeckSpanKernel(DK_AUTO)
+    };
+}
+
+static render_facing_data GetFacingData(game_state *GS) {
+    deck_column_kernel *DeckKernel = GetDeckColumnKernel(
+        GS->Config.DeckKernel
+    );
+    ray_packet_kernel *RayKernel = GetRayPacketKernel(GS->Config.RayKernel);
+    layer_run_kernel *LayerKernel = GetLayerRunKernel(
+        GS->Config.LayerKernel
+    );
+    return (render_facing_data) {
+        .GS = GS,
+        .SpriteRenderInfos = GS->Tables->Sprites.Infos,
+        .DeckKernel = DeckKernel ?: GetDeckColumnKernel(DK_AUTO),
+        .RayKernel = RayKernel ?: GetRayPacketKernel(RK_AUTO),
+        .LayerKernel = LayerKernel ?: GetLayerRunKernel(LK_AUTO),
+        .FusedColumns = GS->Config.FusedColumns
+    };
+}
+
+static void UpscaleTask(
+    void *TaskData, 
+    int32_t JobI, 
+    [[maybe_unused]] int32_t WorkerI
+) {
+    const upscale *Upscale = TaskData;
+    int32_t StartY = JobI * UPSCALE_JOB_ROWS;
+    int32_t EndY = MIN(StartY + UPSCALE_JOB_ROWS, Upscale->DstHeight);
+    UpscaleRows(Upscale, StartY, EndY);
+}
+
+static upscale GetUpscale(const game_state *GS) {
+    return (upscale) {
+        .Src = GS->Scene.Pixels,
+        .SrcWidth = GS->Scene.Width,
+        .SrcHeight = GS->Scene.Height,
+        .Dst = GS->Screen.Pixels,
+        .DstWidth = GS->Screen.Width,
+        .DstHeight = GS->Screen.Height
+    };
+}
+
+/*Adds a job without a task that waits on Count jobs from FirstJobI*/
+static int32_t AddGraphJoin(
+    job_graph *Graph, 
+    int32_t FirstJobI, 
+    int32_t Count
+) {
+    int32_t JoinI = AddGraphJobs(Graph, NULL, NULL, 1);
+    for(int32_t I = 0; I < Count; I++) {
+        AddGraphEdge(Graph, FirstJobI + I, JoinI);
     }
-    WorkerMultiWait(_countof(GS->Workers), GS->Workers); 
+    return JoinI;
 }
 
-static void RenderFacing(game_state *GS, sprite_render_info SpriteRenderInfos[static SPR_CAP]) {
-    render_facing_data TaskData[_countof(GS->Workers)];
+/*
+ * Sprites are projected, sorted and binned while the tables and decks are
+ * drawn. A facing job reads the decks of whichever rows its walls cover,
+ * so split columns start facing jobs once every deck job is done, while
+ * fused columns start each as soon as the tables and sprite bins are. The
+ * upscale waits for every facing job. StageBarriers instead has each stage
+ * wait for the whole one before it, in the order the stages are listed.
+ */
+static frame_jobs BuildFrameGraph(
+    job_graph *Graph,
+    game_state *GS,
+    render_decks_data *DecksData,
+    render_facing_data *FacingData,
+    upscale *Upscale
+) {
+    bool HasDecks = !GS->Config.FusedColumns;
+    bool HasUpscale = GS->Scene.Pixels != GS->Screen.Pixels;
+    bool HasBarriers = GS->Config.StageBarriers;
+    int32_t DeckCount = CountJobs(GS->Scene.Height / 2, DECK_JOB_ROWS);
+    int32_t UpscaleCount = CountJobs(GS->Screen.Height, UPSCALE_JOB_ROWS);
 
-    for(size_t I = 0; I < _countof(TaskData); I++) {
-        TaskData[I] = (render_facing_data) {
-            .GS = GS,
-            .StartX = I * DIB_WIDTH / _countof(TaskData), 
-            .EndX = (I + 1) * DIB_WIDTH / _countof(TaskData),
-            .SpriteRenderInfos = SpriteRenderInfos
-        };
+    ResetJobGraph(Graph);
+    frame_jobs Jobs = {
+        .DeckCount = HasDecks ? DeckCount : 0,
+        .FacingCount = CountJobs(GS->Scene.Width, FACING_JOB_COLS),
+        .UpscaleCount = HasUpscale ? UpscaleCount : 0
+    };
+    Jobs.Infos = AddGraphJobs(Graph, ComputeSpriteInfosTask, GS, 1);
+    Jobs.Sort = AddGraphJobs(Graph, SortSpritesTask, GS, 1);
+    Jobs.Tables = AddGraphJobs(Graph, UpdateTablesTask, GS, 1);
+    Jobs.Decks = AddGraphJobs(
+        Graph, 
+        RenderDecksTask, 
+        DecksData, 
+        Jobs.DeckCount
+    );
+    Jobs.Facing = AddGraphJobs(
+        Graph, 
+        RenderFacingTask, 
+        FacingData, 
+        Jobs.FacingCount
+    );
+    Jobs.Upscale = AddGraphJobs(
+        Graph, 
+        UpscaleTask, 
+        Upscale, 
+        Jobs.UpscaleCount
+    );
 
-        GS->Workers[I].Data = &TaskData[I]; 
-        GS->Workers[I].Task = RenderFacingTask;
+    AddGraphEdge(Graph, Jobs.Infos, Jobs.Sort);
+    if(HasBarriers) {
+        AddGraphEdge(Graph, Jobs.Sort, Jobs.Tables);
+    }
+    for(int32_t I = 0; I < Jobs.DeckCount; I++) {
+        AddGraphEdge(Graph, Jobs.Tables, Jobs.Decks + I);
     }
-    WorkerMultiWait(_countof(GS->Workers), GS->Workers); 
+
+    int32_t FacingInputI = (
+        HasDecks ? 
+        AddGraphJoin(Graph, Jobs.Decks, Jobs.DeckCount) :
+        Jobs.Tables
+    );
+    for(int32_t I = 0; I < Jobs.FacingCount; I++) {
+        AddGraphEdge(Graph, Jobs.Sort, Jobs.Facing + I);
+        AddGraphEdge(Graph, FacingInputI, Jobs.Facing + I);
+    }
+
+    if(HasUpscale) {
+        int32_t FacingDoneI = AddGraphJoin(
+            Graph, 
+            Jobs.Facing, 
+            Jobs.FacingCount
+        );
+        for(int32_t I = 0; I < Jobs.UpscaleCount; I++) {
+            AddGraphEdge(Graph, FacingDoneI, Jobs.Upscale + I);
+        }
+    }
+    return Jobs;
 }
 
+/*
+ * The frame runs as one job graph on the pool. Stage times span from the
+ * first job of a stage starting to its last finishing, so with stages
+ * overlapping they add up to more than RenderNS. They and the usage are
+ * read from the workers' traces of the graph.
+ */
 void RenderWorld(game_state *GS) {
-    SortSprites(GS);
+    int64_t StartTime = QueryTimeNS();
+    render_stats *Stats = &GS->FrameStats;
+    Stats->SceneWidth = GS->Scene.Width;
+    Stats->SceneHeight = GS->Scene.Height;
 
-    sprite_render_info SpriteRenderInfos[SPR_CAP];
-    ComputeRenderSpriteInfos(GS, SpriteRenderInfos);
+    job_graph *Graph = &GS->Tables->Graph;
+    render_decks_data DecksData = GetDecksData(GS);
+    render_facing_data FacingData = GetFacingData(GS);
+    upscale Upscale = GetUpscale(GS);
+    frame_jobs Jobs = BuildFrameGraph(
+        Graph, 
+        GS, 
+        &DecksData, 
+        &FacingData, 
+        &Upscale
+    );
+    RunJobGraph(&GS->Pool, Graph);
 
-    RenderDecks(GS);
-    RenderFacing(GS, SpriteRenderInfos);
-}
+    Stats->RenderNS = QueryTimeNS() - StartTime;
+
+    /*DecksIncludeTheTablesTheyRead*/
+    const worker_pool *Pool = &GS->Pool;
+    Stats->ComputeRenderSpriteInfosNS = GetGraphJobsNS(Pool, Jobs.Infos, 1);
+    Stats->SortSpritesNS = GetGraphJobsNS(Pool, Jobs.Sort, 1);
+    Stats->RenderDecksNS = GetGraphJobsNS(
+        Pool, 
+        Jobs.Tables, 
+        1 + Jobs.DeckCount
+    );
+    Stats->RenderFacingNS = GetGraphJobsNS(
+        Pool, 
+        Jobs.Facing, 
+        Jobs.FacingCount
+    );
+    Stats->UpscaleNS = GetGraphJobsNS(Pool, Jobs.Upscale, Jobs.UpscaleCount);
 
+    Stats->DeckSpreadNS = GetGraphJobSpreadNS(
+        Pool, 
+        Jobs.Decks, 
+        Jobs.DeckCount
+    );
+    Stats->FacingSpreadNS = GetGraphJobSpreadNS(
+        Pool, 
+        Jobs.Facing, 
+        Jobs.FacingCount
+    );
+    Stats->WorkerCount = Pool->WorkerCount;
+    Stats->Usage = GetBatchUsage(Pool);
+}
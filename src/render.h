@@ -7,11 +7,20 @@
 #include "descent.h"
 
 void RenderWorld(game_state *GS);
-void FillColor(color Texture[TEX_LENGTH][TEX_LENGTH], color Color);
+void CreateFogLevels(uint8_t FogLevels[static FOG_LEVEL_COUNT]);
+float CalcFogHorizon(const uint8_t FogLevels[static FOG_LEVEL_COUNT]);
 
+/*Maps a distance to the 8-bit fog scale of its table step*/
 [[maybe_unused]]
-static inline bool IsInTileMap(size_t Row, size_t Col) {
-    return Row < TILE_HEIGHT && Col < TILE_WIDTH;
+static inline uint8_t CalcFogLevel(
+    const uint8_t FogLevels[static FOG_LEVEL_COUNT], 
+    float Dis
+) {
+    int32_t I = (int32_t) (Dis * FOG_STEPS_PER_TILE);
+    if(I < 0) {
+        return FogLevels[0];
+    }
+    return I < FOG_LEVEL_COUNT ? FogLevels[I] : 0;
 }
 
 #endif
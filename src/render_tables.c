@@ -0,0 +1,199 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "render.h"
+#include "render_tables.h"
+#include "scalar.h"
+#include "shade.h"
+#include "vec2.h"
+
+static float CalcRowDis(int32_t Height, int32_t FloorY) {
+    int32_t Horizon = Height / 2 - FloorY;
+    float PosZ = 0.5F * Height;
+    return PosZ / (float) Horizon;
+}
+
+/*
+ * A floor pixel spans RowDis / Width of a tile across, as the view plane
+ * is one tile wide at a distance of one, and the gap to the next row's
+ * distance down. The row at the horizon has no next row and gets the
+ * smallest mips, which the fog hides anyway.
+ */
+static int32_t CalcRowMipBias(int32_t Width, int32_t Height, int32_t FloorY) {
+    float RowDis = CalcRowDis(Height, FloorY);
+    float Across = RowDis / (float) Width;
+    float Down = (
+        FloorY + 1 < Height / 2 ? 
+        CalcRowDis(Height, FloorY + 1) - RowDis : 
+        INFINITY
+    );
+    int32_t Bias = ilogbf(MAX(Across, Down));
+    return MIN(MAX(Bias, -MAX_TEX_LOG2), 0);
+}
+
+/*Fills a deck row's Shade and TexShift*/
+static void SetRowTexture(
+    scene_tables *Tables,
+    const shade_cache *Shades,
+    int32_t Y,
+    int32_t TexI,
+    uint8_t FogLevel,
+    int32_t MipBias
+) {
+    texture Full = GetShadedTexture(Shades, 0, false, TexI);
+    texture Mip = SelectMip(Full, MipBias);
+    uint32_t MipOffset = (uint32_t) (Mip.Texels - Full.Texels);
+    Tables->Shade[Y] = GetShadeOffset(Shades, FogLevel, false) + MipOffset;
+    Tables->TexShift[Y] = 32 - Mip.Log2Length;
+}
+
+static void BuildSceneTables(scene_tables *Tables, const game_state *GS) {
+    int32_t Width = GS->Scene.Width;
+    int32_t Height = GS->Scene.Height;
+    Tables->Width = Width;
+    Tables->Height = Height;
+
+    /*RowsOnlyGetFartherTowardTheHorizon*/
+    int32_t FogFloorY = 0;
+    for(int32_t FloorY = 0; FloorY < Height / 2; FloorY++) {
+        float RowDis = CalcRowDis(Height, FloorY);
+        uint8_t FogLevel = CalcFogLevel(GS->FogLevels, RowDis);
+        int32_t MipBias = CalcRowMipBias(Width, Height, FloorY);
+        int32_t CeilY = Height - FloorY - 1;
+        Tables->RowDis[FloorY] = RowDis;
+        Tables->MipBias[FloorY] = MipBias;
+        Tables->Fog[FloorY] = FogLevel;
+        Tables->Fog[CeilY] = FogLevel / 2;
+        SetRowTexture(
+            Tables, 
+            GS->Shades, 
+            FloorY, 
+            FLOOR_TEX_I, 
+            FogLevel, 
+            MipBias
+        );
+        SetRowTexture(
+            Tables, 
+            GS->Shades, 
+            CeilY, 
+            CEIL_TEX_I, 
+            FogLevel / 2, 
+            MipBias
+        );
+        if(RowDis < GS->FogHorizon) {
+            FogFloorY = FloorY + 1;
+        }
+    }
+    Tables->FogFloorY = FogFloorY;
+
+    for(int32_t LineHeight = 0; LineHeight < MAX_LINE_STEPS; LineHeight++) {
+        Tables->LineSteps[LineHeight] = CalcLineStep(Height, LineHeight);
+    }
+
+    for(int32_t X = 0; X < Width; X++) {
+        Tables->CameraX[X] = (float) (X << 1) / (float) Width - 1;
+    }
+}
+
+static void BuildCameraTables(
+    camera_tables *Tables,
+    const scene_tables *Scene,
+    const game_state *GS
+) {
+    /*CalcDeckRows*/
+    const render_view *View = &GS->View;
+    vec2 RayDir = SubVec2(View->Dir, View->Plane);
+    vec2 PlaneTwice = MulVec2(View->Plane, 2);
+    for(int32_t FloorY = 0; FloorY < Scene->FogFloorY; FloorY++) {
+        float RowDis = Scene->RowDis[FloorY];
+
+        /*CalcFloorStep*/
+        float UnitRowDis = RowDis / (float) Scene->Width;
+        vec2 FloorStep = MulVec2(PlaneTwice, UnitRowDis);
+
+        /*CalcInitFloor*/
+        vec2 DeltaFloor = MulVec2(RayDir, RowDis);
+        vec2 Floor = AddVec2(View->Pos, DeltaFloor);
+
+        int32_t CeilY = Scene->Height - FloorY - 1;
+        Tables->U[FloorY] = Tables->U[CeilY] = ToDeckFixed(Floor.X);
+        Tables->V[FloorY] = Tables->V[CeilY] = ToDeckFixed(Floor.Y);
+        Tables->StepU[FloorY] = Tables->StepU[CeilY] = ToDeckFixed(
+            FloorStep.X
+        );
+        Tables->StepV[FloorY] = Tables->StepV[CeilY] = ToDeckFixed(
+            FloorStep.Y
+        );
+    }
+
+    /*CalcColumnRays*/
+    for(int32_t X = 0; X < Scene->Width; X++) {
+        float CameraX = Scene->CameraX[X];
+        float RayDirX = View->Dir.X + View->Plane.X * CameraX;
+        float RayDirY = View->Dir.Y + View->Plane.Y * CameraX;
+        Tables->RayDirX[X] = RayDirX;
+        Tables->RayDirY[X] = RayDirY;
+        Tables->DeltaDistX[X] = ABS(1.0F / RayDirX);
+        Tables->DeltaDistY[X] = ABS(1.0F / RayDirY);
+    }
+}
+
+render_tables *CreateRenderTables(void) {
+    return calloc(1, sizeof(render_tables));
+}
+
+void DestroyRenderTables(render_tables *Tables) {
+    if(Tables) {
+        free(Tables->Sprites.Infos);
+        free(Tables->Sprites.Order);
+        free(Tables->Sprites.SortTemp);
+        free(Tables->Sprites.Keys);
+        free(Tables->SpriteBins.Items);
+    }
+    free(Tables);
+}
+
+/*Arrays that did grow are kept, Cap only moves once all of them have*/
+bool ReserveSpriteTables(render_tables *Tables, uint32_t Cap) {
+    sprite_tables *Sprites = &Tables->Sprites;
+    if(Cap <= Sprites->Cap) {
+        return true;
+    }
+
+    sprite_render_info *Infos = realloc(Sprites->Infos, Cap * sizeof(*Infos));
+    Sprites->Infos = Infos ?: Sprites->Infos;
+    uint32_t *Order = realloc(Sprites->Order, Cap * sizeof(*Order));
+    Sprites->Order = Order ?: Sprites->Order;
+    uint32_t *SortTemp = realloc(Sprites->SortTemp, Cap * sizeof(*SortTemp));
+    Sprites->SortTemp = SortTemp ?: Sprites->SortTemp;
+    uint16_t *Keys = realloc(Sprites->Keys, Cap * sizeof(*Keys));
+    Sprites->Keys = Keys ?: Sprites->Keys;
+    if(!Infos || !Order || !SortTemp || !Keys) {
+        return false;
+    }
+
+    Sprites->Cap = Cap;
+    return true;
+}
+
+bool ReserveSpriteBins(sprite_bins *Bins, uint32_t ItemCount) {
+    if(ItemCount <= Bins->ItemCap) {
+        return true;
+    }
+    uint32_t ItemCap = MAX(ItemCount, 2 * Bins->ItemCap);
+    uint32_t *Items = realloc(Bins->Items, ItemCap * sizeof(*Items));
+    if(!Items) {
+        return false;
+    }
+    Bins->Items = Items;
+    Bins->ItemCap = ItemCap;
+    return true;
+}
+
+void UpdateRenderTables(render_tables *Tables, const game_state *GS) {
+    scene_tables *Scene = &Tables->Scene;
+    if(Scene->Width != GS->Scene.Width || Scene->Height != GS->Scene.Height) {
+        BuildSceneTables(Scene, GS);
+    }
+    BuildCameraTables(&Tables->Camera, Scene, GS);
+}
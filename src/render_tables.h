@@ -0,0 +1,169 @@
+#ifndef RENDER_TABLES_H
+#define RENDER_TABLES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "descent.h"
+#include "scalar.h"
+
+#define SPRITE_BIN_WIDTH 16
+#define MAX_SPRITE_BINS (MAX_DIB_WIDTH / SPRITE_BIN_WIDTH)
+
+/*Texture slots the decks are drawn with*/
+#define FLOOR_TEX_I 1
+#define CEIL_TEX_I 2
+
+/*Line heights past this are rare enough to step without the table*/
+#define MAX_LINE_STEPS (2 * MAX_DIB_HEIGHT)
+#define LINE_STEP_SHIFT 16
+
+/*
+ * Texture rows in 16.16 fixed point for a line LineHeight rows tall,
+ * centred on a scene Height rows tall. Step is for a MAX_TEX_LENGTH
+ * texture and rounded down, so the last row stays on the texture;
+ * GetTexStep shifts it down to a smaller texture, which rounds the same
+ * as dividing for that texture directly. HiddenRows is how many rows
+ * are cut off at the top when the line is taller than the scene. A row
+ * spans a LineHeight-th of a tile, which picks the mip as SelectMip takes
+ * it.
+ */
+typedef struct line_step {
+    uint32_t Step;
+    int32_t HiddenRows;
+    int32_t MipBias;
+} line_step;
+
+/*
+ * Depends only on the scene size and the fog, so it is rebuilt when the
+ * scene size changes. Floor rows from FogFloorY up, and their ceilings,
+ * are past the fog. Fog is indexed by screen row, with ceiling rows at
+ * half the fog of their mirrored floor row. MipBias is indexed by floor
+ * row and picks the mip for it and its ceiling row as SelectMip takes it.
+ * Shade is each row's offset into the shade cache, to its fog level and
+ * the mip of its deck texture, and TexShift takes the row's coordinates
+ * to that mip's texels, both as deck_column takes them.
+ */
+typedef struct scene_tables {
+    int32_t Width; /*Zero until the first build*/
+    int32_t Height;
+    int32_t FogFloorY;
+    float RowDis[MAX_DIB_HEIGHT / 2];
+    int32_t MipBias[MAX_DIB_HEIGHT / 2];
+    uint32_t Fog[MAX_DIB_HEIGHT];
+    uint32_t Shade[MAX_DIB_HEIGHT];
+    uint32_t TexShift[MAX_DIB_HEIGHT];
+    line_step LineSteps[MAX_LINE_STEPS];
+    float CameraX[MAX_DIB_WIDTH];
+} scene_tables;
+
+/*
+ * Depends on the camera, so it is rebuilt once a frame before the workers
+ * start and then only read. Deck coordinates are indexed by screen row as
+ * deck_column expects and only set below the fog; ray values are indexed
+ * by screen column.
+ */
+typedef struct camera_tables {
+    uint32_t U[MAX_DIB_HEIGHT];
+    uint32_t V[MAX_DIB_HEIGHT];
+    uint32_t StepU[MAX_DIB_HEIGHT];
+    uint32_t StepV[MAX_DIB_HEIGHT];
+
+    float RayDirX[MAX_DIB_WIDTH];
+    float RayDirY[MAX_DIB_WIDTH];
+    float DeltaDistX[MAX_DIB_WIDTH];
+    float DeltaDistY[MAX_DIB_WIDTH];
+} camera_tables;
+
+/*Where a sprite lands on screen, zeroed when it is culled*/
+typedef struct sprite_render_info {
+    float TransformY;
+    int32_t SpriteScreenX;
+    int32_t SpriteWidth; 
+    int32_t SpriteHeight;
+    uint8_t FogLevel;
+
+    int32_t DrawStartX;
+    int32_t DrawEndX;
+    int32_t DrawStartY;
+    int32_t DrawEndY;
+    int32_t VMoveScreen;
+} sprite_render_info;
+
+/*
+ * Per-sprite arrays with room for Cap sprites, grown with the sprite
+ * store. Order lists the VisibleCount sprites that survived culling,
+ * nearest first once sorted, by index into the sprite store. Keys holds
+ * their quantized depths and SortTemp is the radix sort's other buffer.
+ */
+typedef struct sprite_tables {
+    uint32_t Cap;
+    sprite_render_info *Infos;
+    uint32_t *Order;
+    uint32_t *SortTemp;
+    uint16_t *Keys;
+    uint32_t VisibleCount;
+} sprite_tables;
+
+/*
+ * Sprites overlapping each SPRITE_BIN_WIDTH wide column range, rebuilt
+ * with the sprite infos each frame. A bin lists its sprites in sorted
+ * order as Items[Start[BinI]] up to Items[Start[BinI + 1]].
+ */
+typedef struct sprite_bins {
+    int32_t BinCount;
+    uint32_t Start[MAX_SPRITE_BINS + 1];
+    uint32_t ItemCap;
+    uint32_t *Items;
+} sprite_bins;
+
+struct render_tables {
+    scene_tables Scene;
+    camera_tables Camera;
+    sprite_tables Sprites;
+    sprite_bins SpriteBins;
+    job_graph Graph; /*Of the frame, rebuilt by every RenderWorld*/
+};
+
+/*Returns NULL when the tables cannot be allocated*/
+render_tables *CreateRenderTables(void);
+void DestroyRenderTables(render_tables *Tables);
+
+/*Both return false when the arrays cannot grow and leave them as they were*/
+bool ReserveSpriteTables(render_tables *Tables, uint32_t Cap);
+bool ReserveSpriteBins(sprite_bins *Bins, uint32_t ItemCount);
+
+/*Rebuilds the scene tables only when the scene size changed*/
+void UpdateRenderTables(render_tables *Tables, const game_state *GS);
+
+[[maybe_unused]]
+static inline line_step CalcLineStep(int32_t Height, int32_t LineHeight) {
+    if(LineHeight <= 0) {
+        return (line_step) {};
+    }
+    int32_t CeilLog2 = LineHeight > 1 ? 32 - __builtin_clz(LineHeight - 1) : 0;
+    return (line_step) {
+        .Step = (uint32_t) (MAX_TEX_LENGTH << LINE_STEP_SHIFT) / LineHeight,
+        .HiddenRows = MAX(LineHeight / 2 - Height / 2, 0),
+        .MipBias = -MIN(CeilLog2, MAX_TEX_LOG2)
+    };
+}
+
+/*Same as CalcLineStep, through the scene tables when they cover it*/
+[[maybe_unused]]
+static inline line_step GetLineStep(
+    const scene_tables *Scene, 
+    int32_t LineHeight
+) {
+    if((uint32_t) LineHeight < MAX_LINE_STEPS) {
+        return Scene->LineSteps[LineHeight];
+    }
+    return CalcLineStep(Scene->Height, LineHeight);
+}
+
+[[maybe_unused]]
+static inline uint32_t GetTexStep(line_step Line, int32_t Log2Length) {
+    return Line.Step >> (MAX_TEX_LOG2 - Log2Length);
+}
+
+#endif
@@ -13,6 +13,10 @@
     A_ > B_ ? A_ : B_;\
 })
 
+#ifndef _countof
+#define _countof(A) (sizeof(A) / sizeof(*(A)))
+#endif
+
 #define ABS(A) ({\
     __auto_type A_ = (A);\
     A_ < 0 ? -A_ : A_;\
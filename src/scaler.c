@@ -0,0 +1,54 @@
+#include "scaler.h"
+
+/*Frames a new scale is measured for before it can change again*/
+#define SCALE_COOLDOWN 15
+
+/*Growing must fit within this share of the budget, in percent*/
+#define SCALE_GROW_PCT 90
+
+void CreateResScaler(res_scaler *Scaler, int64_t BudgetNS) {
+    *Scaler = (res_scaler) {
+        .BudgetNS = BudgetNS,
+        .Scale = SCALE_ONE
+    };
+}
+
+/*Frame time goes with the pixel count, so with the square of the scale*/
+static int64_t PredictFrameNS(int64_t FrameNS, int32_t From, int32_t To) {
+    return FrameNS * To * To / (From * From);
+}
+
+bool UpdateResScaler(res_scaler *Scaler, int64_t FrameNS) {
+    if(Scaler->BudgetNS <= 0) {
+        return false;
+    }
+
+    /*UpdateAverage*/
+    if(Scaler->AvgNS == 0) {
+        Scaler->AvgNS = FrameNS;
+    } else {
+        Scaler->AvgNS += (FrameNS - Scaler->AvgNS) / 8;
+    }
+    if(Scaler->Cooldown > 0) {
+        Scaler->Cooldown--;
+        return false;
+    }
+
+    int32_t Scale = Scaler->Scale;
+    if(Scaler->AvgNS > Scaler->BudgetNS) {
+        Scale--;
+    } else {
+        int64_t GrowNS = PredictFrameNS(Scaler->AvgNS, Scale, Scale + 1);
+        if(GrowNS * 100 < Scaler->BudgetNS * SCALE_GROW_PCT) {
+            Scale++;
+        }
+    }
+    if(Scale < SCALE_MIN || Scale > SCALE_ONE || Scale == Scaler->Scale) {
+        return false;
+    }
+
+    Scaler->AvgNS = PredictFrameNS(Scaler->AvgNS, Scaler->Scale, Scale);
+    Scaler->Scale = Scale;
+    Scaler->Cooldown = SCALE_COOLDOWN;
+    return true;
+}
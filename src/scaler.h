@@ -0,0 +1,29 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*Scene sizes are kept in sixteenths of the screen size*/
+#define SCALE_ONE 16
+#define SCALE_MIN 6
+
+/*
+ * Dynamic resolution controller. Shrinks the scene while the average
+ * frame time is over budget and grows it back once the larger size is
+ * predicted to fit, waiting a few frames between changes so each new
+ * size gets measured before the next decision.
+ */
+typedef struct res_scaler {
+    int64_t BudgetNS; /*Zero keeps the scene at full size*/
+    int64_t AvgNS;
+    int32_t Scale;
+    int32_t Cooldown;
+} res_scaler;
+
+void CreateResScaler(res_scaler *Scaler, int64_t BudgetNS);
+
+/*Returns true when Scale changed*/
+bool UpdateResScaler(res_scaler *Scaler, int64_t FrameNS);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+
+#include "scalar.h"
+#include "shade.h"
+
+/*The scale a level stands for, rounded, so the ends stay black and unlit*/
+static uint8_t CalcLevelScale(int32_t LevelCount, int32_t LevelI) {
+    int32_t Top = LevelCount - 1;
+    return (uint8_t) ((LevelI * 255 + Top / 2) / Top);
+}
+
+static int32_t CalcScaleLevel(int32_t LevelCount, int32_t Scale) {
+    return (Scale * (LevelCount - 1) + 127) / 255;
+}
+
+static void ShadeTexture(
+    color *Plain,
+    color *Side,
+    const texture *Texture,
+    uint8_t Scale
+) {
+    for(int32_t I = 0; I < GetTexelCount(Texture); I++) {
+        color Shaded = ScaleColor(Texture->Texels[I], Scale);
+        Plain[I] = Shaded;
+        Side[I] = HalfColor(Shaded);
+    }
+}
+
+shade_cache *CreateShadeCache(
+    int32_t LevelCount,
+    int32_t TexCount,
+    const texture Textures[static TexCount]
+) {
+    shade_cache *Cache = malloc(sizeof(*Cache));
+    if(!Cache) {
+        return NULL;
+    }
+    *Cache = (shade_cache) {
+        .TexCount = TexCount
+    };
+    size_t FullTexels = 0;
+    for(int32_t TexI = 0; TexI < TexCount; TexI++) {
+        Cache->TexOffsets[TexI] = Cache->SideStride;
+        Cache->Log2Lengths[TexI] = Textures[TexI].Log2Length;
+        Cache->MipCounts[TexI] = Textures[TexI].MipCount;
+        Cache->SideStride += GetTexelCount(&Textures[TexI]);
+        FullTexels += (size_t) 1 << 2 * Textures[TexI].Log2Length;
+    }
+    Cache->LevelStride = 2 * Cache->SideStride;
+
+    /*FitTheBudget*/
+    size_t BudgetBytes = 2 * FullTexels * sizeof(color);
+    LevelCount = LevelCount ?: MAX_SHADE_LEVELS;
+    LevelCount = MIN(MAX(LevelCount, MIN_SHADE_LEVELS), MAX_SHADE_LEVELS);
+    LevelCount = MIN(
+        LevelCount,
+        MAX((int32_t) (MAX_SHADE_BYTES / BudgetBytes), MIN_SHADE_LEVELS)
+    );
+    Cache->LevelCount = LevelCount;
+    size_t LevelBytes = (size_t) Cache->LevelStride * sizeof(color);
+    Cache->Texels = malloc(LevelCount * LevelBytes);
+    if(!Cache->Texels) {
+        free(Cache);
+        return NULL;
+    }
+
+    for(int32_t Scale = 0; Scale < MAX_SHADE_LEVELS; Scale++) {
+        int32_t LevelI = CalcScaleLevel(LevelCount, Scale);
+        Cache->Offsets[Scale] = LevelI * Cache->LevelStride;
+    }
+    for(int32_t LevelI = 0; LevelI < LevelCount; LevelI++) {
+        uint8_t Scale = CalcLevelScale(LevelCount, LevelI);
+        color *Level = &Cache->Texels[LevelI * Cache->LevelStride];
+        for(int32_t TexI = 0; TexI < TexCount; TexI++) {
+            int32_t Offset = Cache->TexOffsets[TexI];
+            ShadeTexture(
+                &Level[Offset],
+                &Level[Cache->SideStride + Offset],
+                &Textures[TexI],
+                Scale
+            );
+        }
+    }
+    return Cache;
+}
+
+void DestroyShadeCache(shade_cache *Cache) {
+    if(Cache) {
+        free(Cache->Texels);
+    }
+    free(Cache);
+}
@@ -0,0 +1,87 @@
+#ifndef SHADE_H
+#define SHADE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "color.h"
+#include "descent.h"
+#include "texture.h"
+
+/*Fog scales are 8-bit, so more levels than this would never be fetched*/
+#define MAX_SHADE_LEVELS 256
+#define MIN_SHADE_LEVELS 2
+
+/*
+ * Large textures get fewer levels so the full-size copies fit in this.
+ * Mips are left out, so they never cost fog levels but can add up to a
+ * third on top.
+ */
+#define MAX_SHADE_BYTES ((size_t) 256 << 20)
+
+/*
+ * Copies of the loaded textures already scaled by the fog, built once at
+ * load so the renderer fetches shaded texels instead of scaling them.
+ * Each fog scale maps to one of LevelCount levels spread evenly from black
+ * to unchanged. With MAX_SHADE_LEVELS every scale has its own level and
+ * the copies match ScaleColor exactly; fewer levels band the fog.
+ *
+ * Every level holds a plain copy and a side copy of each texture, with
+ * the side copy darkened by HalfColor as opaque side faces are drawn.
+ * Copies keep their texture's size, mips and Morton order, shaded after
+ * filtering, and are laid out as [Level][Side][TexI], TexOffsets[TexI]
+ * texels into their side.
+ */
+struct shade_cache {
+    int32_t LevelCount;
+    int32_t TexCount;
+    int32_t SideStride; /*Texels in one copy of every texture*/
+    int32_t LevelStride; /*Texels from one level to the next*/
+    uint32_t Offsets[MAX_SHADE_LEVELS]; /*Of each fog scale's level*/
+    int32_t TexOffsets[TEX_COUNT];
+    int32_t Log2Lengths[TEX_COUNT];
+    int32_t MipCounts[TEX_COUNT];
+    color *Texels;
+};
+
+/*
+ * Zero LevelCount asks for MAX_SHADE_LEVELS. Levels are clamped to the
+ * supported range and then lowered, no further than MIN_SHADE_LEVELS,
+ * until the full-size copies fit MAX_SHADE_BYTES. TexCount is at most
+ * TEX_COUNT. Returns NULL when the copies cannot be allocated.
+ */
+shade_cache *CreateShadeCache(
+    int32_t LevelCount,
+    int32_t TexCount,
+    const texture Textures[static TexCount]
+);
+void DestroyShadeCache(shade_cache *Cache);
+
+/*Texels of texture 0 at the fog scale's level, add TexOffsets[TexI]*/
+[[maybe_unused]]
+static inline uint32_t GetShadeOffset(
+    const shade_cache *Cache,
+    uint8_t Fog,
+    bool Side
+) {
+    return Cache->Offsets[Fog] + (Side ? Cache->SideStride : 0);
+}
+
+/*TexI must be below TexCount*/
+[[maybe_unused]]
+static inline texture GetShadedTexture(
+    const shade_cache *Cache,
+    uint8_t Fog,
+    bool Side,
+    int32_t TexI
+) {
+    uint32_t Offset = GetShadeOffset(Cache, Fog, Side);
+    return (texture) {
+        .Log2Length = Cache->Log2Lengths[TexI],
+        .MipCount = Cache->MipCounts[TexI],
+        .Texels = &Cache->Texels[Offset + Cache->TexOffsets[TexI]]
+    };
+}
+
+#endif
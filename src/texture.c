@@ -0,0 +1,96 @@
+#include <stdlib.h>
+
+#include "texture.h"
+
+/*Each doubling adds the next coordinate bit, two bits up from the last*/
+#define SPREAD_2(N) (N), (N) + 1
+#define SPREAD_4(N) SPREAD_2(N), SPREAD_2((N) + 0x4)
+#define SPREAD_8(N) SPREAD_4(N), SPREAD_4((N) + 0x10)
+#define SPREAD_16(N) SPREAD_8(N), SPREAD_8((N) + 0x40)
+#define SPREAD_32(N) SPREAD_16(N), SPREAD_16((N) + 0x100)
+#define SPREAD_64(N) SPREAD_32(N), SPREAD_32((N) + 0x400)
+#define SPREAD_128(N) SPREAD_64(N), SPREAD_64((N) + 0x1000)
+#define SPREAD_256(N) SPREAD_128(N), SPREAD_128((N) + 0x4000)
+#define SPREAD_512(N) SPREAD_256(N), SPREAD_256((N) + 0x10000)
+#define SPREAD_1024(N) SPREAD_512(N), SPREAD_512((N) + 0x40000)
+
+const uint32_t g_SpreadTexBits[MAX_TEX_LENGTH] = {SPREAD_1024(0)};
+
+bool CreateTexture(texture *Texture, int32_t Log2Length, bool HasMips) {
+    texture Created = {
+        .Log2Length = Log2Length,
+        .MipCount = HasMips ? Log2Length + 1 : 1
+    };
+    Created.Texels = calloc(GetTexelCount(&Created), sizeof(color));
+    if(!Created.Texels) {
+        return false;
+    }
+    *Texture = Created;
+    return true;
+}
+
+void DestroyTexture(texture *Texture) {
+    free(Texture->Texels);
+    *Texture = (texture) {};
+}
+
+void FillTexture(texture *Texture, color Color) {
+    for(int32_t I = 0; I < GetTexelCount(Texture); I++) {
+        Texture->Texels[I] = Color;
+    }
+}
+
+/*
+ * Box filter over a 2x2 block. Cutouts, where every alpha is 0 or 255,
+ * stay cutouts so sprite edges neither fade nor fringe: the block is
+ * opaque when at least half of it is, coloured by its opaque texels alone.
+ */
+static color FilterTexels(const color Block[static 4]) {
+    int32_t Sums[4] = {};
+    int32_t OpaqueSums[3] = {};
+    int32_t OpaqueCount = 0;
+    bool IsCutout = true;
+    for(int32_t I = 0; I < 4; I++) {
+        color Texel = Block[I];
+        Sums[0] += Texel.Red;
+        Sums[1] += Texel.Green;
+        Sums[2] += Texel.Blue;
+        Sums[3] += Texel.Alpha;
+        if(IsOpaque(Texel)) {
+            OpaqueSums[0] += Texel.Red;
+            OpaqueSums[1] += Texel.Green;
+            OpaqueSums[2] += Texel.Blue;
+            OpaqueCount++;
+        } else if(Texel.Alpha != 0) {
+            IsCutout = false;
+        }
+    }
+
+    if(IsCutout && OpaqueCount < 2) {
+        return (color) {};
+    } else if(IsCutout) {
+        int32_t Half = OpaqueCount / 2;
+        return OpaqueColor(
+            (OpaqueSums[0] + Half) / OpaqueCount,
+            (OpaqueSums[1] + Half) / OpaqueCount,
+            (OpaqueSums[2] + Half) / OpaqueCount
+        );
+    }
+    return (color) {
+        .Red = (Sums[0] + 2) / 4,
+        .Green = (Sums[1] + 2) / 4,
+        .Blue = (Sums[2] + 2) / 4,
+        .Alpha = (Sums[3] + 2) / 4
+    };
+}
+
+void BuildMips(texture *Texture) {
+    for(int32_t Level = 1; Level < Texture->MipCount; Level++) {
+        texture Bigger = GetMip(*Texture, Level - 1);
+        texture Mip = GetMip(*Texture, Level);
+        int32_t Count = 1 << 2 * Mip.Log2Length;
+        for(int32_t I = 0; I < Count; I++) {
+            Mip.Texels[I] = FilterTexels(&Bigger.Texels[4 * I]);
+        }
+    }
+}
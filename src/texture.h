@@ -0,0 +1,184 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "color.h"
+#include "scalar.h"
+
+#define MIN_TEX_LOG2 4
+#define MAX_TEX_LOG2 10
+#define MIN_TEX_LENGTH (1 << MIN_TEX_LOG2)
+#define MAX_TEX_LENGTH (1 << MAX_TEX_LOG2)
+
+/*
+ * Square texture, power-of-two texels a side, with its texels in Morton
+ * order: the bits of X and Y alternate in the index, Y in the lowest bit.
+ * Texels near each other on both axes stay near each other in memory, so
+ * a wall column walking down Y and a floor row cutting across at an angle
+ * both keep hitting the same cache lines. X runs along the wall or the
+ * floor's U and Y runs down the wall or along V.
+ *
+ * The texels are followed by MipCount - 1 mips, each half the length of
+ * the one before. A 2x2 block is four texels in a row in Morton order, so
+ * each mip texel filters the four texels at four times its index. Every
+ * mip is itself a texture, with the smaller mips after it.
+ */
+typedef struct texture {
+    int32_t Log2Length;
+    int32_t MipCount; /*Including the full size, at most Log2Length + 1*/
+    color *Texels;
+} texture;
+
+/*
+ * Texels start zeroed, call BuildMips once the full size is filled in.
+ * Returns false when they cannot be allocated.
+ */
+bool CreateTexture(texture *Texture, int32_t Log2Length, bool HasMips);
+void DestroyTexture(texture *Texture);
+void FillTexture(texture *Texture, color Color);
+void BuildMips(texture *Texture);
+
+[[maybe_unused]]
+static inline int32_t GetTexLength(const texture *Texture) {
+    return 1 << Texture->Log2Length;
+}
+
+/*Texels before the mip at Level, so of every bigger level*/
+[[maybe_unused]]
+static inline int32_t GetMipOffset(int32_t Log2Length, int32_t Level) {
+    int32_t Top = 1 << 2 * (Log2Length + 1);
+    return (Top - (Top >> 2 * Level)) / 3;
+}
+
+/*Texels of every level*/
+[[maybe_unused]]
+static inline int32_t GetTexelCount(const texture *Texture) {
+    return GetMipOffset(Texture->Log2Length, Texture->MipCount);
+}
+
+/*Level must be below MipCount*/
+[[maybe_unused]]
+static inline texture GetMip(texture Texture, int32_t Level) {
+    return (texture) {
+        .Log2Length = Texture.Log2Length - Level,
+        .MipCount = Texture.MipCount - Level,
+        .Texels = &Texture.Texels[GetMipOffset(Texture.Log2Length, Level)]
+    };
+}
+
+/*
+ * MipBias is how many texels a screen pixel spans along its longer side,
+ * as a power of two rounded down, for a texture of one texel a tile. A
+ * texture 2^Log2Length texels a tile spans Log2Length more, so that many
+ * levels down it spans one or two texels a pixel and samples without
+ * skipping. The level is clamped to the mips there are.
+ */
+[[maybe_unused]]
+static inline texture SelectMip(texture Texture, int32_t MipBias) {
+    int32_t Level = Texture.Log2Length + MipBias;
+    return GetMip(Texture, MIN(MAX(Level, 0), Texture.MipCount - 1));
+}
+
+/*Each coordinate below MAX_TEX_LENGTH with its bits moved to every other bit*/
+extern const uint32_t g_SpreadTexBits[MAX_TEX_LENGTH];
+
+/*A lookup beats the shifts for one coordinate, vectors shift instead*/
+[[maybe_unused]]
+static inline uint32_t SpreadTexBits(uint32_t Coord) {
+    return g_SpreadTexBits[Coord];
+}
+
+[[maybe_unused]]
+static inline uint32_t GetTexelI(uint32_t X, uint32_t Y) {
+    return SpreadTexBits(X) << 1 | SpreadTexBits(Y);
+}
+
+/*
+ * Vectors spread with shifts instead. Bits is the most any coordinate has
+ * and should be a constant, so the steps that only move bits the
+ * coordinates never have compile away. With AVX2 a coordinate of one
+ * nibble is spread by a byte shuffle.
+ */
+
+#ifdef __SSE2__
+
+static inline __m128i SpreadTexBits4(__m128i Coords, int32_t Bits) {
+    if(Bits > 8) {
+        Coords = _mm_and_si128(
+            _mm_or_si128(Coords, _mm_slli_epi32(Coords, 8)),
+            _mm_set1_epi32(0x00FF00FF)
+        );
+    }
+    if(Bits > 4) {
+        Coords = _mm_and_si128(
+            _mm_or_si128(Coords, _mm_slli_epi32(Coords, 4)),
+            _mm_set1_epi32(0x0F0F0F0F)
+        );
+    }
+    Coords = _mm_and_si128(
+        _mm_or_si128(Coords, _mm_slli_epi32(Coords, 2)),
+        _mm_set1_epi32(0x33333333)
+    );
+    return _mm_and_si128(
+        _mm_or_si128(Coords, _mm_slli_epi32(Coords, 1)),
+        _mm_set1_epi32(0x55555555)
+    );
+}
+
+static inline __m128i GetTexelI4(__m128i X, __m128i Y, int32_t Bits) {
+    return _mm_or_si128(
+        _mm_slli_epi32(SpreadTexBits4(X, Bits), 1),
+        SpreadTexBits4(Y, Bits)
+    );
+}
+
+#endif
+
+#ifdef COLOR_X86
+
+__attribute__((target("avx2")))
+static inline __m256i SpreadTexBits8(__m256i Coords, int32_t Bits) {
+    if(Bits <= 4) {
+        __m256i Nibbles = _mm256_setr_epi8(
+            0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15,
+            0x40, 0x41, 0x44, 0x45, 0x50, 0x51, 0x54, 0x55,
+            0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15,
+            0x40, 0x41, 0x44, 0x45, 0x50, 0x51, 0x54, 0x55
+        );
+        return _mm256_shuffle_epi8(Nibbles, Coords);
+    }
+    if(Bits > 8) {
+        Coords = _mm256_and_si256(
+            _mm256_or_si256(Coords, _mm256_slli_epi32(Coords, 8)),
+            _mm256_set1_epi32(0x00FF00FF)
+        );
+    }
+    if(Bits > 4) {
+        Coords = _mm256_and_si256(
+            _mm256_or_si256(Coords, _mm256_slli_epi32(Coords, 4)),
+            _mm256_set1_epi32(0x0F0F0F0F)
+        );
+    }
+    Coords = _mm256_and_si256(
+        _mm256_or_si256(Coords, _mm256_slli_epi32(Coords, 2)),
+        _mm256_set1_epi32(0x33333333)
+    );
+    return _mm256_and_si256(
+        _mm256_or_si256(Coords, _mm256_slli_epi32(Coords, 1)),
+        _mm256_set1_epi32(0x55555555)
+    );
+}
+
+__attribute__((target("avx2")))
+static inline __m256i GetTexelI8(__m256i X, __m256i Y, int32_t Bits) {
+    return _mm256_or_si256(
+        _mm256_slli_epi32(SpreadTexBits8(X, Bits), 1),
+        SpreadTexBits8(Y, Bits)
+    );
+}
+
+#endif
+
+#endif
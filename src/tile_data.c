@@ -1,3 +1,4 @@
+#include "scalar.h"
 #include "tile_data.h"
 
 static tile_data TileData[] = {
@@ -19,6 +20,9 @@ static tile_data TileData[] = {
     [TD_GLASS_VERT] = {
         .TexI = 4,
         .Flags = TF_VERT | TF_SOLID | TF_ALPHA
+    },
+    [TD_EDGE] = {
+        .Flags = TF_SOLID
     }
 };
 
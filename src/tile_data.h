@@ -15,7 +15,8 @@ typedef enum tile {
     TD_WOOD,
     TD_GHOST,
     TD_GLASS_HORZ,
-    TD_GLASS_VERT
+    TD_GLASS_VERT,
+    TD_EDGE /*Map border, stops rays and is never drawn*/
 } tile;
 
 typedef struct tile_data {
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+
+#include "tile_map.h"
+
+static void SetTileAt(tile_map *Map, int32_t TileI, tile Tile) {
+    uint64_t Bit = (uint64_t) 1 << (TileI & 63);
+    Map->Memory[TileI] = Tile;
+    Map->AreRadiiStale = true;
+    if(GetTileData(Tile).Flags & TF_ALPHA) {
+        Map->StopBits[TileI >> 6] &= ~Bit;
+    } else {
+        Map->StopBits[TileI >> 6] |= Bit;
+    }
+}
+
+/*The inside starts as TD_NONE, which is all zero bytes and clear bits*/
+bool CreateTileMap(tile_map *Map, int32_t Width, int32_t Height) {
+    if(
+        Width < 1 || Width > MAX_TILE_MAP_LENGTH ||
+        Height < 1 || Height > MAX_TILE_MAP_LENGTH
+    ) {
+        return false;
+    }
+
+    int32_t Stride = Width + 2;
+    size_t CellCount = (size_t) Stride * (Height + 2);
+    uint8_t *Memory = calloc(CellCount + TILE_MAP_PADDING, sizeof(*Memory));
+    uint64_t *StopBits = calloc((CellCount + 63) / 64, sizeof(*StopBits));
+    uint8_t *EmptyRadii = malloc(CellCount * sizeof(*EmptyRadii));
+    if(!Memory || !StopBits || !EmptyRadii) {
+        free(Memory);
+        free(StopBits);
+        free(EmptyRadii);
+        return false;
+    }
+
+    *Map = (tile_map) {
+        .Width = Width,
+        .Height = Height,
+        .Stride = Stride,
+        .Memory = Memory,
+        .StopBits = StopBits,
+        .EmptyRadii = EmptyRadii
+    };
+    for(int32_t X = -1; X <= Width; X++) {
+        SetTileAt(Map, GetTileI(Map, X, -1), TD_EDGE);
+        SetTileAt(Map, GetTileI(Map, X, Height), TD_EDGE);
+    }
+    for(int32_t Y = 0; Y < Height; Y++) {
+        SetTileAt(Map, GetTileI(Map, -1, Y), TD_EDGE);
+        SetTileAt(Map, GetTileI(Map, Width, Y), TD_EDGE);
+    }
+    UpdateEmptyRadii(Map);
+    return true;
+}
+
+void DestroyTileMap(tile_map *Map) {
+    free(Map->Memory);
+    free(Map->StopBits);
+    free(Map->EmptyRadii);
+    *Map = (tile_map) {};
+}
+
+void SetTile(tile_map *Map, int32_t X, int32_t Y, tile Tile) {
+    SetTileAt(Map, GetTileI(Map, X, Y), Tile);
+}
+
+static void LowerRadius(uint8_t *Radius, uint8_t Neighbor) {
+    if(Neighbor + 1 < *Radius) {
+        *Radius = Neighbor + 1;
+    }
+}
+
+/*
+ * Two-pass chamfer transform with unit weights on all eight neighbours,
+ * which gives the exact Chebyshev distance. The border cells are never
+ * empty, so every row and column has a non-empty cell to start from and
+ * the passes only look at neighbours inside the bordered map.
+ */
+void UpdateEmptyRadii(tile_map *Map) {
+    if(!Map->AreRadiiStale) {
+        return;
+    }
+    int32_t Stride = Map->Stride;
+    int32_t Rows = Map->Height + 2;
+    uint8_t *Radii = Map->EmptyRadii;
+    for(int32_t I = 0; I < Stride * Rows; I++) {
+        Radii[I] = Map->Memory[I] == TD_NONE ? MAX_EMPTY_RADIUS : 0;
+    }
+
+    /*ForwardPass*/
+    for(int32_t Y = 1; Y < Rows - 1; Y++) {
+        for(int32_t X = 1; X < Stride - 1; X++) {
+            uint8_t *Radius = &Radii[Y * Stride + X];
+            LowerRadius(Radius, Radius[-Stride - 1]);
+            LowerRadius(Radius, Radius[-Stride]);
+            LowerRadius(Radius, Radius[-Stride + 1]);
+            LowerRadius(Radius, Radius[-1]);
+        }
+    }
+
+    /*BackwardPass*/
+    for(int32_t Y = Rows - 2; Y > 0; Y--) {
+        for(int32_t X = Stride - 2; X > 0; X--) {
+            uint8_t *Radius = &Radii[Y * Stride + X];
+            LowerRadius(Radius, Radius[Stride + 1]);
+            LowerRadius(Radius, Radius[Stride]);
+            LowerRadius(Radius, Radius[Stride - 1]);
+            LowerRadius(Radius, Radius[1]);
+        }
+    }
+    Map->AreRadiiStale = false;
+}
@@ -0,0 +1,81 @@
+#ifndef TILE_MAP_H
+#define TILE_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tile_data.h"
+
+#define MAX_TILE_MAP_LENGTH 4096
+#define MAX_EMPTY_RADIUS 255
+
+/*Bytes past the last cell, so every cell can be read as four bytes*/
+#define TILE_MAP_PADDING 3
+
+/*
+ * Heap tile map ringed by a one-tile border of TD_EDGE, so a ray walking
+ * out of the map always stops on the border and the traversal needs no
+ * bounds checks. Cells from -1 to Width and Height inclusive can be read.
+ * StopBits holds one bit per cell, border included, set where the cell
+ * stops a ray, so the traversal can test it before loading the tile.
+ *
+ * EmptyRadii holds per cell the Chebyshev distance to the nearest cell
+ * that is not TD_NONE, capped at MAX_EMPTY_RADIUS. Every cell less than
+ * that many cells away on both axes is empty. SetTile marks it stale and
+ * UpdateEmptyRadii rebuilds it.
+ */
+typedef struct tile_map {
+    int32_t Width;
+    int32_t Height;
+    int32_t Stride; /*Cells per row, border included*/
+    uint8_t *Memory;
+    uint64_t *StopBits;
+    uint8_t *EmptyRadii;
+    bool AreRadiiStale;
+} tile_map;
+
+/*Returns false on a bad size or when the map cannot be allocated*/
+bool CreateTileMap(tile_map *Map, int32_t Width, int32_t Height);
+void DestroyTileMap(tile_map *Map);
+
+/*X and Y must be inside the map, the border cannot be changed*/
+void SetTile(tile_map *Map, int32_t X, int32_t Y, tile Tile);
+
+/*Does nothing unless a tile changed since the last update*/
+void UpdateEmptyRadii(tile_map *Map);
+
+[[maybe_unused]]
+static inline bool IsInTileMap(const tile_map *Map, int32_t X, int32_t Y) {
+    return (
+        (uint32_t) X < (uint32_t) Map->Width && 
+        (uint32_t) Y < (uint32_t) Map->Height
+    );
+}
+
+/*Index of a cell in Memory and StopBits*/
+[[maybe_unused]]
+static inline int32_t GetTileI(const tile_map *Map, int32_t X, int32_t Y) {
+    return (Y + 1) * Map->Stride + X + 1;
+}
+
+[[maybe_unused]]
+static inline tile GetTile(const tile_map *Map, int32_t X, int32_t Y) {
+    return Map->Memory[GetTileI(Map, X, Y)];
+}
+
+[[maybe_unused]]
+static inline int32_t GetEmptyRadius(
+    const tile_map *Map, 
+    int32_t X, 
+    int32_t Y
+) {
+    return Map->EmptyRadii[GetTileI(Map, X, Y)];
+}
+
+[[maybe_unused]]
+static inline bool IsTileStop(const tile_map *Map, int32_t X, int32_t Y) {
+    int32_t TileI = GetTileI(Map, X, Y);
+    return Map->StopBits[TileI >> 6] >> (TileI & 63) & 1;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static inline int64_t QueryTimeNS(void) {
+#ifdef _WIN32
+    static int64_t s_PerfFreq;
+    if(s_PerfFreq == 0LL) {
+        LARGE_INTEGER PerfFreq;
+        QueryPerformanceFrequency(&PerfFreq);
+        s_PerfFreq = PerfFreq.QuadPart;
+    }
+    LARGE_INTEGER PerfCounter;
+    QueryPerformanceCounter(&PerfCounter);
+    return (
+        PerfCounter.QuadPart / s_PerfFreq * 1000000000LL + 
+        PerfCounter.QuadPart % s_PerfFreq * 1000000000LL / s_PerfFreq 
+    );
+#else
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (int64_t) Time.tv_sec * 1000000000LL + Time.tv_nsec;
+#endif
+}
+
+#endif
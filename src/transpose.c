@@ -0,0 +1,97 @@
+#include "scalar.h"
+#include "transpose.h"
+
+#define TRANSPOSE_TILE 8
+
+static void TransposeTileScalar(
+    int32_t Rows,
+    int32_t Cols,
+    const color *Src,
+    size_t SrcStride,
+    color *Dst,
+    size_t DstStride
+) {
+    for(int32_t Y = 0; Y < Rows; Y++) {
+        for(int32_t X = 0; X < Cols; X++) {
+            Dst[X * DstStride + Y] = Src[Y * SrcStride + X];
+        }
+    }
+}
+
+#ifdef __SSE2__
+
+static inline void Transpose4x4SSE2(
+    const color *Src,
+    size_t SrcStride,
+    color *Dst,
+    size_t DstStride
+) {
+    __m128i R0 = _mm_loadu_si128((const __m128i *) &Src[0 * SrcStride]);
+    __m128i R1 = _mm_loadu_si128((const __m128i *) &Src[1 * SrcStride]);
+    __m128i R2 = _mm_loadu_si128((const __m128i *) &Src[2 * SrcStride]);
+    __m128i R3 = _mm_loadu_si128((const __m128i *) &Src[3 * SrcStride]);
+
+    __m128i T0 = _mm_unpacklo_epi32(R0, R1);
+    __m128i T1 = _mm_unpacklo_epi32(R2, R3);
+    __m128i T2 = _mm_unpackhi_epi32(R0, R1);
+    __m128i T3 = _mm_unpackhi_epi32(R2, R3);
+
+    __m128i *Out = (__m128i *) Dst;
+    _mm_storeu_si128(Out, _mm_unpacklo_epi64(T0, T1));
+    Out = (__m128i *) &Dst[1 * DstStride];
+    _mm_storeu_si128(Out, _mm_unpackhi_epi64(T0, T1));
+    Out = (__m128i *) &Dst[2 * DstStride];
+    _mm_storeu_si128(Out, _mm_unpacklo_epi64(T2, T3));
+    Out = (__m128i *) &Dst[3 * DstStride];
+    _mm_storeu_si128(Out, _mm_unpackhi_epi64(T2, T3));
+}
+
+static void Transpose8x8SSE2(
+    const color *Src,
+    size_t SrcStride,
+    color *Dst,
+    size_t DstStride
+) {
+    size_t SrcHalf = 4 * SrcStride;
+    size_t DstHalf = 4 * DstStride;
+    Transpose4x4SSE2(Src, SrcStride, Dst, DstStride);
+    Transpose4x4SSE2(Src + 4, SrcStride, Dst + DstHalf, DstStride);
+    Transpose4x4SSE2(Src + SrcHalf, SrcStride, Dst + 4, DstStride);
+    Src += SrcHalf + 4;
+    Dst += DstHalf + 4;
+    Transpose4x4SSE2(Src, SrcStride, Dst, DstStride);
+}
+
+#endif
+
+void TransposeColors(
+    int32_t Rows,
+    int32_t Cols,
+    const color *Src,
+    size_t SrcStride,
+    color *Dst,
+    size_t DstStride
+) {
+    for(int32_t Y = 0; Y < Rows; Y += TRANSPOSE_TILE) {
+        int32_t TileRows = MIN(Rows - Y, TRANSPOSE_TILE);
+        for(int32_t X = 0; X < Cols; X += TRANSPOSE_TILE) {
+            int32_t TileCols = MIN(Cols - X, TRANSPOSE_TILE);
+            const color *SrcTile = &Src[Y * SrcStride + X];
+            color *DstTile = &Dst[X * DstStride + Y];
+#ifdef __SSE2__
+            if(TileRows == TRANSPOSE_TILE && TileCols == TRANSPOSE_TILE) {
+                Transpose8x8SSE2(SrcTile, SrcStride, DstTile, DstStride);
+                continue;
+            }
+#endif
+            TransposeTileScalar(
+                TileRows,
+                TileCols,
+                SrcTile,
+                SrcStride,
+                DstTile,
+                DstStride
+            );
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "color.h"
+
+/*
+ * Writes the transpose of a Rows x Cols block of Src into Dst. Strides are
+ * in colors. Works through 8x8 tiles so both sides stay cache-local.
+ */
+void TransposeColors(
+    int32_t Rows,
+    int32_t Cols,
+    const color *Src,
+    size_t SrcStride,
+    color *Dst,
+    size_t DstStride
+);
+
+#endif
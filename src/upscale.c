@@ -0,0 +1,86 @@
+#include <string.h>
+
+#include "upscale.h"
+
+typedef void upscale_row(
+    const color *Src,
+    color *Dst,
+    int32_t Width,
+    uint32_t StepX
+);
+
+static inline uint32_t CalcUpscaleStep(int32_t Src, int32_t Dst) {
+    return ((uint32_t) Src << 16) / (uint32_t) Dst;
+}
+
+static void UpscaleRowScalar(
+    const color *Src,
+    color *Dst,
+    int32_t Width,
+    uint32_t StepX
+) {
+    for(int32_t X = 0; X < Width; X++) {
+        Dst[X] = Src[(uint32_t) X * StepX >> 16];
+    }
+}
+
+#ifdef COLOR_X86
+
+/*Sixteen pixels per iteration as two eight-lane gathers*/
+__attribute__((target("avx2")))
+static void UpscaleRowAVX2(
+    const color *Src,
+    color *Dst,
+    int32_t Width,
+    uint32_t StepX
+) {
+    const int *SrcRow = (const int *) Src;
+    __m256i Lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i Pos = _mm256_mullo_epi32(Lanes, _mm256_set1_epi32(StepX));
+    __m256i Step8 = _mm256_set1_epi32(8 * StepX);
+
+    int32_t X = 0;
+    for(; X + 16 <= Width; X += 16) {
+        __m256i SrcX0 = _mm256_srli_epi32(Pos, 16);
+        Pos = _mm256_add_epi32(Pos, Step8);
+        __m256i SrcX1 = _mm256_srli_epi32(Pos, 16);
+        Pos = _mm256_add_epi32(Pos, Step8);
+
+        __m256i *Out = (__m256i *) &Dst[X];
+        _mm256_storeu_si256(Out, _mm256_i32gather_epi32(SrcRow, SrcX0, 4));
+        _mm256_storeu_si256(Out + 1, _mm256_i32gather_epi32(SrcRow, SrcX1, 4));
+    }
+    for(; X < Width; X++) {
+        Dst[X] = Src[(uint32_t) X * StepX >> 16];
+    }
+}
+
+#endif
+
+/*Rows that repeat a source row are copied from the row below*/
+void UpscaleRows(const upscale *Upscale, int32_t StartY, int32_t EndY) {
+    uint32_t StepX = CalcUpscaleStep(Upscale->SrcWidth, Upscale->DstWidth);
+    uint32_t StepY = CalcUpscaleStep(Upscale->SrcHeight, Upscale->DstHeight);
+    int32_t Width = Upscale->DstWidth;
+
+#ifdef COLOR_X86
+    upscale_row *UpscaleRow = HasAVX2() ? UpscaleRowAVX2 : UpscaleRowScalar;
+#else
+    upscale_row *UpscaleRow = UpscaleRowScalar;
+#endif
+
+    int32_t PrevSrcY = -1;
+    for(int32_t Y = StartY; Y < EndY; Y++) {
+        int32_t SrcY = (uint32_t) Y * StepY >> 16;
+        color *DstRow = &Upscale->Dst[(size_t) Y * Width];
+        if(SrcY == PrevSrcY) {
+            memcpy(DstRow, DstRow - Width, Width * sizeof(*DstRow));
+        } else {
+            const color *SrcRow = &Upscale->Src[
+                (size_t) SrcY * Upscale->SrcWidth
+            ];
+            UpscaleRow(SrcRow, DstRow, Width, StepX);
+        }
+        PrevSrcY = SrcY;
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef UPSCALE_H
+#define UPSCALE_H
+
+#include <stdint.h>
+
+#include "color.h"
+
+/*Both images are bottom row first with rows Width colors apart*/
+typedef struct upscale {
+    const color *Src;
+    int32_t SrcWidth;
+    int32_t SrcHeight;
+
+    color *Dst;
+    int32_t DstWidth;
+    int32_t DstHeight;
+} upscale;
+
+/*
+ * Nearest-neighbour upscale into rows [StartY, EndY) of Dst, so the rows
+ * can be split between workers. Source coordinates are 16.16 fixed-point.
+ */
+void UpscaleRows(const upscale *Upscale, int32_t StartY, int32_t EndY);
+
+#endif
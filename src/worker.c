@@ -1,46 +1,719 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "scalar.h"
+#include "timer.h"
 #include "worker.h"
 
-#include <stdio.h>
+#define JOB_EMPTY -1
+#define JOB_RETRY -2
+
+static void ResetJobDeque(job_deque *Deque) {
+    atomic_store(&Deque->Top, 0);
+    atomic_store(&Deque->Bottom, 0);
+}
+
+/*
+ * Only the owner pushes, before its batch starts or while it runs a graph.
+ * Thieves read the slot only after the release of Bottom publishes it.
+ */
+static void PushJob(job_deque *Deque, int32_t JobI) {
+    int64_t Bottom = atomic_load_explicit(&Deque->Bottom, memory_order_relaxed);
+    assert(Bottom - atomic_load(&Deque->Top) < JOB_DEQUE_CAP);
+
+    atomic_store_explicit(
+        &Deque->Jobs[Bottom & (JOB_DEQUE_CAP - 1)], 
+        JobI, 
+        memory_order_relaxed
+    );
+    atomic_store_explicit(&Deque->Bottom, Bottom + 1, memory_order_release);
+}
+
+static int32_t PopJob(job_deque *Deque) {
+    int64_t Bottom = atomic_load_explicit(
+        &Deque->Bottom, 
+        memory_order_relaxed
+    ) - 1;
+    atomic_store(&Deque->Bottom, Bottom);
+    int64_t Top = atomic_load(&Deque->Top);
+
+    if(Top > Bottom) {
+        atomic_store_explicit(&Deque->Bottom, Bottom + 1, memory_order_relaxed);
+        return JOB_EMPTY;
+    }
+
+    int32_t JobI = atomic_load_explicit(
+        &Deque->Jobs[Bottom & (JOB_DEQUE_CAP - 1)],
+        memory_order_relaxed
+    );
+    if(Top == Bottom) {
+        /*LastJobRacesThieves*/
+        if(!atomic_compare_exchange_strong(&Deque->Top, &Top, Top + 1)) {
+            JobI = JOB_EMPTY;
+        }
+        atomic_store_explicit(&Deque->Bottom, Bottom + 1, memory_order_relaxed);
+    }
+    return JobI;
+}
+
+static int32_t StealJob(job_deque *Deque) {
+    int64_t Top = atomic_load_explicit(&Deque->Top, memory_order_acquire);
+    /*Orders Top before Bottom against the owner's pop, or both take a job*/
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t Bottom = atomic_load_explicit(&Deque->Bottom, memory_order_acquire);
+    if(Top >= Bottom) {
+        return JOB_EMPTY;
+    }
+
+    int32_t JobI = atomic_load_explicit(
+        &Deque->Jobs[Top & (JOB_DEQUE_CAP - 1)],
+        memory_order_relaxed
+    );
+    if(!atomic_compare_exchange_strong(&Deque->Top, &Top, Top + 1)) {
+        return JOB_RETRY;
+    }
+    return JobI;
+}
+
+/*Visits every other worker once, retrying victims that lost a race*/
+static int32_t StealFromPool(worker *Worker) {
+    worker_pool *Pool = Worker->Pool;
+    bool Contended;
+    do {
+        Contended = false;
+        for(int32_t I = 1; I < Pool->WorkerCount; I++) {
+            int32_t VictimI = (Worker->WorkerI + I) % Pool->WorkerCount;
+            int32_t JobI = StealJob(&Pool->Workers[VictimI].Deque);
+            if(JobI >= 0) {
+                return JobI;
+            }
+            Contended |= JobI == JOB_RETRY;
+        }
+    } while(Contended);
+    return JOB_EMPTY;
+}
+
+static inline void SpinPause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static int64_t LoadRelaxed(_Atomic int64_t *Value) {
+    return atomic_load_explicit(Value, memory_order_relaxed);
+}
 
-DWORD WINAPI ThreadWorkerProc(LPVOID VoidWorker) {
-    worker *Worker = (worker *) VoidWorker;
+static void StoreRelaxed(_Atomic int64_t *Value, int64_t NewValue) {
+    atomic_store_explicit(Value, NewValue, memory_order_relaxed);
+}
 
-    while(WaitForSingleObject(Worker->StartEvent, INFINITE) == WAIT_OBJECT_0) {
-        assert(Worker->Task != NULL && Worker->Data != NULL);
+/*The worker is the only writer, so plain stores bump the version*/
+static void BeginWaitLogWrite(worker_wait_log *Log) {
+    uint32_t Version = atomic_load_explicit(
+        &Log->Version, 
+        memory_order_relaxed
+    );
+    atomic_store_explicit(&Log->Version, Version + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void EndWaitLogWrite(worker_wait_log *Log) {
+    uint32_t Version = atomic_load_explicit(
+        &Log->Version, 
+        memory_order_relaxed
+    );
+    atomic_store_explicit(&Log->Version, Version + 1, memory_order_release);
+}
 
-        Worker->Task(Worker->Data);
-        Worker->Task = NULL;
-        Worker->Data = NULL;
-        SetEvent(Worker->EndEvent);
+/*Ends the phase begun at *StartNS, adding it to *TotalNS*/
+static void EndWaitPhase(
+    worker_wait_log *Log, 
+    _Atomic int64_t *StartNS, 
+    _Atomic int64_t *TotalNS, 
+    _Atomic int64_t *Wakes, 
+    int64_t EndNS
+) {
+    BeginWaitLogWrite(Log);
+    StoreRelaxed(TotalNS, LoadRelaxed(TotalNS) + EndNS - LoadRelaxed(StartNS));
+    StoreRelaxed(StartNS, 0);
+    if(Wakes) {
+        StoreRelaxed(Wakes, LoadRelaxed(Wakes) + 1);
     }
-    return 0UL;
+    EndWaitLogWrite(Log);
 }
 
-void WorkerMultiWait(int WorkerCount, worker *Workers) {
-    assert(WorkerCount < 1024);
+static void BeginWaitPhase(
+    worker_wait_log *Log, 
+    _Atomic int64_t *StartNS, 
+    int64_t NowNS
+) {
+    BeginWaitLogWrite(Log);
+    StoreRelaxed(StartNS, NowNS);
+    EndWaitLogWrite(Log);
+}
 
-    HANDLE EndEvents[WorkerCount]; 
-    int TaskCount = 0;
+/*
+ * Waits while *Addr == Seen. Spins first so back-to-back batches never
+ * reach the kernel, then parks. Parked is published before the final check
+ * so a waker that changes *Addr either is seen here or sees Parked.
+ */
+static void WaitWhileEqual(
+    worker *Worker, 
+    _Atomic uint32_t *Addr, 
+    uint32_t Seen
+) {
+    worker_wait_log *Log = &Worker->WaitLog;
+    BeginWaitPhase(Log, &Log->SpinStartNS, QueryTimeNS());
+    for(int32_t I = 0; I < WORKER_SPIN_COUNT; I++) {
+        if(atomic_load_explicit(Addr, memory_order_acquire) != Seen) {
+            EndWaitPhase(
+                Log, 
+                &Log->SpinStartNS, 
+                &Log->SpinNS, 
+                &Log->SpinWakes, 
+                QueryTimeNS()
+            );
+            return;
+        }
+        SpinPause();
+    }
 
-    for(int I = 0; I < WorkerCount; I++) {
-        if(Workers[I].Task) {
-            EndEvents[TaskCount++] = Workers[I].EndEvent;
-            SetEvent(Workers[I].StartEvent);
+    int64_t ParkStart = QueryTimeNS();
+    EndWaitPhase(Log, &Log->SpinStartNS, &Log->SpinNS, NULL, ParkStart);
+    BeginWaitPhase(Log, &Log->ParkStartNS, ParkStart);
+    while(atomic_load(Addr) == Seen) {
+        atomic_store(&Worker->Parked, true);
+        if(atomic_load(Addr) == Seen) {
+            ParkWorker(Worker, Addr, Seen);
         }
+        atomic_store(&Worker->Parked, false);
     }
-    WaitForMultipleObjects(TaskCount, EndEvents, TRUE, INFINITE);
+    EndWaitPhase(
+        Log, 
+        &Log->ParkStartNS, 
+        &Log->ParkNS, 
+        &Log->ParkWakes, 
+        QueryTimeNS()
+    );
 }
 
-void CreateWorker(worker *Worker) {
-    *Worker = (worker) {
-        .Thread = CreateThread(NULL, 0, ThreadWorkerProc, Worker, 0, NULL), 
-        .StartEvent = CreateEvent(NULL, FALSE, FALSE, NULL),
-        .EndEvent = CreateEvent(NULL, FALSE, FALSE, NULL)
+/*Called after changing *Addr, so a worker that is not parked sees it*/
+static void WakeWorker(worker *Worker, _Atomic uint32_t *Addr) {
+    if(atomic_load(&Worker->Parked)) {
+        UnparkWorker(Worker, Addr);
+    }
+}
+
+/*The span is only counted once EndSpan closes it*/
+static job_span *BeginSpan(worker *Worker, int32_t JobI) {
+    worker_trace *Trace = &Worker->Trace;
+    job_span *Span = &Trace->Spans[Trace->SpanCount % WORKER_TRACE_CAP];
+    int64_t StartNS = QueryTimeNS();
+    int64_t WakeNS = Worker->WokenNS >= 0 ? StartNS - Worker->WokenNS : -1;
+    *Span = (job_span) {
+        .StartNS = StartNS,
+        .JobI = JobI,
+        .WakeNS = (int32_t) MIN(WakeNS, INT32_MAX),
+        .Batch = Worker->Batch
     };
+    Worker->WokenNS = -1;
+    return Span;
+}
+
+static void EndSpan(worker *Worker, job_span *Span) {
+    Span->EndNS = QueryTimeNS();
+    Worker->Trace.SpanCount++;
+}
+
+/*Releases the dependents of a finished job and wakes idle workers*/
+static void RunGraphJob(worker *Worker, job_graph *Graph, int32_t JobI) {
+    graph_job *Job = &Graph->Jobs[JobI];
+    job_span *Span = BeginSpan(Worker, JobI);
+    if(Job->Task) {
+        Job->Task(Job->Data, Job->TaskJobI, Worker->WorkerI);
+    }
+    EndSpan(Worker, Span);
+
+    /*PushedInReverseSoTheFirstPopsFirst*/
+    bool HasReleased = false;
+    for(int32_t I = Job->DependentCount; I-- > 0; ) {
+        int32_t DependentI = Graph->Dependents[Job->FirstDependent + I];
+        if(atomic_fetch_sub(&Graph->Waiting[DependentI], 1) == 1) {
+            PushJob(&Worker->Deque, DependentI);
+            HasReleased = true;
+        }
+    }
+    bool IsLast = atomic_fetch_sub(&Graph->Remaining, 1) == 1;
+
+    if(HasReleased || IsLast) {
+        worker_pool *Pool = Worker->Pool;
+        atomic_store_explicit(
+            &Graph->ReleasedNS, 
+            Span->EndNS, 
+            memory_order_relaxed
+        );
+        atomic_fetch_add(&Graph->Released, 1);
+        UnparkWorkers(Pool->Workers, Pool->WorkerCount, &Graph->Released);
+    }
+}
+
+/*
+ * Jobs become ready while a graph runs, so an empty pool only means
+ * waiting for the next release. Released is read before checking for the
+ * end and looking for a job, so a release after either ends the wait.
+ */
+static void RunGraphJobs(worker *Worker, job_graph *Graph) {
+    while(true) {
+        uint32_t Seen = atomic_load(&Graph->Released);
+        if(atomic_load(&Graph->Remaining) == 0) {
+            break;
+        }
+        int32_t JobI = PopJob(&Worker->Deque);
+        if(JobI < 0) {
+            JobI = StealFromPool(Worker);
+        }
+        if(JobI >= 0) {
+            RunGraphJob(Worker, Graph, JobI);
+        } else {
+            WaitWhileEqual(Worker, &Graph->Released, Seen);
+            Worker->WokenNS = atomic_load_explicit(
+                &Graph->ReleasedNS, 
+                memory_order_relaxed
+            );
+        }
+    }
+}
+
+/*Thread body for workers 1 and up, one batch per generation*/
+void RunWorker(worker *Worker) {
+    worker_pool *Pool = Worker->Pool;
+    /*Threads can start after the first batch, so begin from generation 0*/
+    uint32_t Seen = 0;
+    while(true) {
+        WaitWhileEqual(Worker, &Pool->Generation, Seen);
+        Seen = atomic_load(&Pool->Generation);
+        if(!Pool->Graph) {
+            return;
+        }
+        Worker->Batch = Seen;
+        Worker->WokenNS = Pool->StartNS;
+
+        RunGraphJobs(Worker, Pool->Graph);
+        if(atomic_fetch_sub(&Pool->Pending, 1) == 1) {
+            WakeWorker(&Pool->Workers[0], &Pool->Pending);
+        }
+    }
+}
+
+/*
+ * Splits the jobs listed in JobIs into contiguous runs, one per worker.
+ * Runs are pushed in reverse so owners pop them in order while thieves
+ * take from the end.
+ */
+static void DealJobs(
+    worker_pool *Pool, 
+    int32_t JobCount, 
+    const int32_t *JobIs
+) {
+    int32_t WorkerCount = Pool->WorkerCount;
+    for(int32_t I = 0; I < WorkerCount; I++) {
+        job_deque *Deque = &Pool->Workers[I].Deque;
+        int32_t StartJob = (int64_t) I * JobCount / WorkerCount;
+        int32_t EndJob = (int64_t) (I + 1) * JobCount / WorkerCount;
+
+        ResetJobDeque(Deque);
+        for(int32_t J = EndJob; J-- > StartJob; ) {
+            PushJob(Deque, JobIs[J]);
+        }
+    }
+}
+
+/*Runs the dealt jobs with the calling thread acting as worker 0*/
+static void RunBatch(worker_pool *Pool) {
+    int32_t WorkerCount = Pool->WorkerCount;
+
+    /*StartBatch*/
+    worker *Caller = &Pool->Workers[0];
+    Pool->StartNS = QueryTimeNS();
+    Caller->WokenNS = -1;
+    atomic_store(&Pool->Pending, WorkerCount - 1);
+    Caller->Batch = atomic_fetch_add(&Pool->Generation, 1) + 1;
+    UnparkWorkers(Pool->Workers, WorkerCount, &Pool->Generation);
+
+    RunGraphJobs(Caller, Pool->Graph);
+
+    /*JoinBatch*/
+    uint32_t Pending;
+    while((Pending = atomic_load(&Pool->Pending)) != 0) {
+        WaitWhileEqual(Caller, &Pool->Pending, Pending);
+    }
+}
+
+void ResetJobGraph(job_graph *Graph) {
+    Graph->JobCount = 0;
+    Graph->EdgeCount = 0;
+}
+
+int32_t AddGraphJobs(
+    job_graph *Graph, 
+    worker_task *Task, 
+    void *Data, 
+    int32_t JobCount
+) {
+    int32_t FirstJobI = Graph->JobCount;
+    assert(FirstJobI + JobCount <= GRAPH_JOB_CAP);
+    for(int32_t I = 0; I < JobCount; I++) {
+        Graph->Jobs[FirstJobI + I] = (graph_job) {
+            .Task = Task,
+            .Data = Data,
+            .TaskJobI = I
+        };
+    }
+    Graph->JobCount += JobCount;
+    return FirstJobI;
+}
+
+void AddGraphEdge(job_graph *Graph, int32_t From, int32_t To) {
+    assert(Graph->EdgeCount < GRAPH_EDGE_CAP);
+    assert(From < Graph->JobCount && To < Graph->JobCount);
+    Graph->Edges[Graph->EdgeCount++] = (graph_edge) {From, To};
+    Graph->Jobs[To].WaitCount++;
 }
 
-void DestroyWorker(worker *Worker) {
-    CloseHandle(Worker->EndEvent); 
-    CloseHandle(Worker->StartEvent); 
-    TerminateThread(Worker->Thread, 0);
+/*Groups the edges by the job they leave, in the order they were added*/
+static void ListDependents(job_graph *Graph) {
+    for(int32_t I = 0; I < Graph->EdgeCount; I++) {
+        Graph->Jobs[Graph->Edges[I].From].DependentCount++;
+    }
+    int32_t Offset = 0;
+    for(int32_t JobI = 0; JobI < Graph->JobCount; JobI++) {
+        graph_job *Job = &Graph->Jobs[JobI];
+        Job->FirstDependent = Offset;
+        Offset += Job->DependentCount;
+        Job->DependentCount = 0;
+    }
+    for(int32_t I = 0; I < Graph->EdgeCount; I++) {
+        graph_job *From = &Graph->Jobs[Graph->Edges[I].From];
+        int32_t DependentI = From->FirstDependent + From->DependentCount++;
+        Graph->Dependents[DependentI] = Graph->Edges[I].To;
+    }
+}
+
+/*Jobs that wait on nothing are dealt out like a batch*/
+void RunJobGraph(worker_pool *Pool, job_graph *Graph) {
+    if(Graph->JobCount == 0) {
+        return;
+    }
+    ListDependents(Graph);
+
+    int32_t RootIs[GRAPH_JOB_CAP];
+    int32_t RootCount = 0;
+    for(int32_t JobI = 0; JobI < Graph->JobCount; JobI++) {
+        int32_t WaitCount = Graph->Jobs[JobI].WaitCount;
+        atomic_store_explicit(
+            &Graph->Waiting[JobI], 
+            WaitCount, 
+            memory_order_relaxed
+        );
+        if(WaitCount == 0) {
+            RootIs[RootCount++] = JobI;
+        }
+    }
+    assert(RootCount > 0);
+    atomic_store(&Graph->Remaining, Graph->JobCount);
+
+    Pool->Graph = Graph;
+    DealJobs(Pool, RootCount, RootIs);
+    RunBatch(Pool);
+    Pool->Graph = NULL;
+}
+
+static void PrepareWorker(
+    worker *Worker, 
+    worker_pool *Pool, 
+    int32_t WorkerI, 
+    worker_proc *Proc,
+    int32_t CoreI
+) {
+    Worker->Pool = Pool;
+    Worker->WorkerI = WorkerI;
+    Worker->Proc = Proc;
+    Worker->CoreI = CoreI;
+    worker_wait_log *Log = &Worker->WaitLog;
+    atomic_store(&Log->Version, 0);
+    StoreRelaxed(&Log->SpinNS, 0);
+    StoreRelaxed(&Log->ParkNS, 0);
+    StoreRelaxed(&Log->SpinWakes, 0);
+    StoreRelaxed(&Log->ParkWakes, 0);
+    StoreRelaxed(&Log->SpinStartNS, 0);
+    StoreRelaxed(&Log->ParkStartNS, 0);
+    Worker->Batch = 0;
+    Worker->WokenNS = -1;
+    Worker->Trace.SpanCount = 0;
+    atomic_store(&Worker->Parked, false);
+    ResetJobDeque(&Worker->Deque);
+}
+
+/*
+ * A WorkerCount of zero sizes the pool from the hardware thread count.
+ * Pinned, worker I runs on core I, so core 0 is left to whichever thread
+ * calls in as worker 0.
+ */
+bool CreateWorkerPool(
+    worker_pool *Pool, 
+    int32_t WorkerCount, 
+    bool IsPinned
+) {
+    if(WorkerCount <= 0) {
+        WorkerCount = GetHardwareThreadCount();
+    }
+    if(WorkerCount > WORKER_CAP) {
+        WorkerCount = WORKER_CAP;
+    }
+
+    Pool->WorkerCount = WorkerCount;
+    Pool->Graph = NULL;
+    atomic_store(&Pool->Generation, 0);
+    atomic_store(&Pool->Pending, 0);
+    for(int32_t I = 0; I < WorkerCount; I++) {
+        PrepareWorker(
+            &Pool->Workers[I], 
+            Pool, 
+            I, 
+            I > 0 ? RunWorker : NULL, 
+            IsPinned && I > 0 ? I : -1
+        );
+    }
+
+    /*ThreadsOnlyReadWorkerCountOnceABatchStarts*/
+    for(int32_t I = 0; I < WorkerCount; I++) {
+        if(!CreateWorker(&Pool->Workers[I])) {
+            Pool->WorkerCount = I;
+            break;
+        }
+    }
+    return Pool->WorkerCount > 0;
+}
+
+void DestroyWorkerPool(worker_pool *Pool) {
+    /*StopBatch*/
+    Pool->Graph = NULL;
+    atomic_fetch_add(&Pool->Generation, 1);
+    UnparkWorkers(Pool->Workers, Pool->WorkerCount, &Pool->Generation);
+
+    for(int32_t I = 0; I < Pool->WorkerCount; I++) {
+        DestroyWorker(&Pool->Workers[I]);
+    }
+    Pool->WorkerCount = 0;
+}
+
+/*Spans of the batch are the newest ones tagged with it*/
+static uint32_t CountBatchSpans(const worker_trace *Trace, uint32_t Batch) {
+    uint32_t Kept = MIN(Trace->SpanCount, WORKER_TRACE_CAP);
+    uint32_t Count = 0;
+    while(Count < Kept) {
+        uint32_t SpanI = (Trace->SpanCount - 1 - Count) % WORKER_TRACE_CAP;
+        if(Trace->Spans[SpanI].Batch != Batch) {
+            break;
+        }
+        Count++;
+    }
+    return Count;
+}
+
+/*Gathers the spans of the pool's last batch, oldest first per worker*/
+static int32_t GetBatchSpans(
+    const worker_pool *Pool, 
+    int32_t WorkerI, 
+    const job_span *Spans[static WORKER_TRACE_CAP]
+) {
+    const worker_trace *Trace = &Pool->Workers[WorkerI].Trace;
+    uint32_t Batch = atomic_load(&Pool->Generation);
+    uint32_t Count = CountBatchSpans(Trace, Batch);
+    for(uint32_t I = 0; I < Count; I++) {
+        uint32_t SpanI = Trace->SpanCount - Count + I;
+        Spans[I] = &Trace->Spans[SpanI % WORKER_TRACE_CAP];
+    }
+    return (int32_t) Count;
+}
+
+static bool IsSpanInJobs(
+    const job_span *Span, 
+    int32_t FirstJobI, 
+    int32_t Count
+) {
+    return Span->JobI >= FirstJobI && Span->JobI < FirstJobI + Count;
+}
+
+int64_t GetGraphJobsNS(
+    const worker_pool *Pool, 
+    int32_t FirstJobI, 
+    int32_t Count
+) {
+    int64_t StartNS = INT64_MAX;
+    int64_t EndNS = INT64_MIN;
+    const job_span *Spans[WORKER_TRACE_CAP];
+    for(int32_t WorkerI = 0; WorkerI < Pool->WorkerCount; WorkerI++) {
+        int32_t SpanCount = GetBatchSpans(Pool, WorkerI, Spans);
+        for(int32_t I = 0; I < SpanCount; I++) {
+            if(IsSpanInJobs(Spans[I], FirstJobI, Count)) {
+                StartNS = MIN(StartNS, Spans[I]->StartNS);
+                EndNS = MAX(EndNS, Spans[I]->EndNS);
+            }
+        }
+    }
+    return StartNS < EndNS ? EndNS - StartNS : 0;
+}
+
+int64_t GetGraphJobSpreadNS(
+    const worker_pool *Pool, 
+    int32_t FirstJobI, 
+    int32_t Count
+) {
+    int64_t MinNS = INT64_MAX;
+    int64_t MaxNS = INT64_MIN;
+    const job_span *Spans[WORKER_TRACE_CAP];
+    for(int32_t WorkerI = 0; WorkerI < Pool->WorkerCount; WorkerI++) {
+        int32_t SpanCount = GetBatchSpans(Pool, WorkerI, Spans);
+        for(int32_t I = 0; I < SpanCount; I++) {
+            if(IsSpanInJobs(Spans[I], FirstJobI, Count)) {
+                int64_t SpanNS = Spans[I]->EndNS - Spans[I]->StartNS;
+                MinNS = MIN(MinNS, SpanNS);
+                MaxNS = MAX(MaxNS, SpanNS);
+            }
+        }
+    }
+    return MinNS <= MaxNS ? MaxNS - MinNS : 0;
+}
+
+batch_usage GetBatchUsage(const worker_pool *Pool) {
+    batch_usage Usage = {};
+    const job_span *Spans[WORKER_TRACE_CAP];
+    for(int32_t WorkerI = 0; WorkerI < Pool->WorkerCount; WorkerI++) {
+        int32_t SpanCount = GetBatchSpans(Pool, WorkerI, Spans);
+        for(int32_t I = 0; I < SpanCount; I++) {
+            const job_span *Span = Spans[I];
+            Usage.BusyNS[WorkerI] += Span->EndNS - Span->StartNS;
+            if(Span->WakeNS >= 0) {
+                Usage.WakeCount++;
+                Usage.WakeSumNS += Span->WakeNS;
+                Usage.WakeMaxNS = MAX(Usage.WakeMaxNS, Span->WakeNS);
+            }
+        }
+    }
+    return Usage;
+}
+
+/*Retries while the worker is writing, then adds the wait going on*/
+static worker_wait_stats ReadWaitLog(worker_wait_log *Log, int64_t NowNS) {
+    worker_wait_stats Stats;
+    int64_t SpinStartNS;
+    int64_t ParkStartNS;
+    uint32_t Version;
+    do {
+        Version = atomic_load_explicit(&Log->Version, memory_order_acquire);
+        Stats = (worker_wait_stats) {
+            .SpinNS = LoadRelaxed(&Log->SpinNS),
+            .ParkNS = LoadRelaxed(&Log->ParkNS),
+            .SpinWakes = LoadRelaxed(&Log->SpinWakes),
+            .ParkWakes = LoadRelaxed(&Log->ParkWakes)
+        };
+        SpinStartNS = LoadRelaxed(&Log->SpinStartNS);
+        ParkStartNS = LoadRelaxed(&Log->ParkStartNS);
+        atomic_thread_fence(memory_order_acquire);
+    } while(
+        (Version & 1) || 
+        Version != atomic_load_explicit(&Log->Version, memory_order_relaxed)
+    );
+
+    if(SpinStartNS) {
+        Stats.SpinNS += NowNS - SpinStartNS;
+    }
+    if(ParkStartNS) {
+        Stats.ParkNS += NowNS - ParkStartNS;
+    }
+    return Stats;
+}
+
+worker_wait_stats SumWorkerWaitStats(const worker_pool *Pool) {
+    worker_wait_stats Sum = {};
+    int64_t NowNS = QueryTimeNS();
+    for(int32_t I = 0; I < Pool->WorkerCount; I++) {
+        worker_wait_log *Log = (worker_wait_log *) &Pool->Workers[I].WaitLog;
+        worker_wait_stats Stats = ReadWaitLog(Log, NowNS);
+        Sum.SpinNS += Stats.SpinNS;
+        Sum.ParkNS += Stats.ParkNS;
+        Sum.SpinWakes += Stats.SpinWakes;
+        Sum.ParkWakes += Stats.ParkWakes;
+    }
+    return Sum;
+}
+
+static async_worker *GetAsyncWorker(worker *Thread) {
+    return (async_worker *) ((char *) Thread - offsetof(async_worker, Thread));
+}
+
+/*Thread body of an async worker, one call per start*/
+static void RunAsyncWorker(worker *Thread) {
+    async_worker *Async = GetAsyncWorker(Thread);
+    uint32_t Seen = 0;
+    while(true) {
+        WaitWhileEqual(Thread, &Async->Started, Seen);
+        Seen = atomic_load(&Async->Started);
+        if(!Async->Call) {
+            return;
+        }
+
+        Async->Call(Async->Data);
+        atomic_store(&Async->Finished, Seen);
+        WakeWorker(&Async->Owner, &Async->Finished);
+    }
+}
+
+bool CreateAsyncWorker(async_worker *Async) {
+    atomic_store(&Async->Started, 0);
+    atomic_store(&Async->Finished, 0);
+    Async->Call = NULL;
+    Async->Data = NULL;
+    PrepareWorker(&Async->Owner, NULL, 0, NULL, -1);
+    PrepareWorker(&Async->Thread, NULL, 1, RunAsyncWorker, -1);
+    if(!CreateWorker(&Async->Owner)) {
+        return false;
+    }
+    if(!CreateWorker(&Async->Thread)) {
+        DestroyWorker(&Async->Owner);
+        return false;
+    }
+    return true;
+}
+
+void DestroyAsyncWorker(async_worker *Async) {
+    JoinAsyncCall(Async);
+
+    /*StartWithoutACall*/
+    Async->Call = NULL;
+    Async->Data = NULL;
+    atomic_fetch_add(&Async->Started, 1);
+    WakeWorker(&Async->Thread, &Async->Started);
+
+    DestroyWorker(&Async->Thread);
+    DestroyWorker(&Async->Owner);
+}
+
+void StartAsyncCall(async_worker *Async, worker_call *Call, void *Data) {
+    assert(
+        atomic_load(&Async->Finished) == atomic_load(&Async->Started)
+    );
+    Async->Call = Call;
+    Async->Data = Data;
+    atomic_fetch_add(&Async->Started, 1);
+    WakeWorker(&Async->Thread, &Async->Started);
+}
+
+void JoinAsyncCall(async_worker *Async) {
+    uint32_t Started = atomic_load(&Async->Started);
+    uint32_t Finished;
+    while((Finished = atomic_load(&Async->Finished)) != Started) {
+        WaitWhileEqual(&Async->Owner, &Async->Finished, Finished);
+    }
 }
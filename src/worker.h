@@ -1,22 +1,281 @@
 #ifndef WORKER_HPP
 #define WORKER_HPP
 
-#include <windows.h>
 #include <assert.h>
-    
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WORKER_CAP 64
+#define JOB_DEQUE_CAP 1024
+
+/*A graph fits in one deque, so releasing jobs never overflows it*/
+#define GRAPH_JOB_CAP JOB_DEQUE_CAP
+#define GRAPH_EDGE_CAP (4 * GRAPH_JOB_CAP)
+
+/*Jobs a worker's trace keeps, enough for a whole graph run on one worker*/
+#define WORKER_TRACE_CAP GRAPH_JOB_CAP
+
+/*Pause iterations before a waiting worker parks*/
+#define WORKER_SPIN_COUNT 4096
+
+typedef void worker_task(void *Data, int32_t JobI, int32_t WorkerI);
+typedef void worker_call(void *Data);
+
+/*
+ * Chase-Lev deque of job indices. The owning worker pops from the bottom
+ * while idle workers steal from the top.
+ */
+typedef struct job_deque {
+    _Atomic int64_t Top;
+    _Atomic int64_t Bottom;
+    _Atomic int32_t Jobs[JOB_DEQUE_CAP];
+} job_deque;
+
+struct worker_pool;
+struct worker;
+
+typedef void worker_proc(struct worker *Worker);
+
+/*
+ * A job of a graph calls Task with TaskJobI once every job it waits on has
+ * finished. A job without a Task only joins the jobs it waits on.
+ */
+typedef struct graph_job {
+    worker_task *Task;
+    void *Data;
+    int32_t TaskJobI;
+    int32_t WaitCount;
+    int32_t FirstDependent;
+    int32_t DependentCount;
+} graph_job;
+
+/*To waits on From*/
+typedef struct graph_edge {
+    int32_t From;
+    int32_t To;
+} graph_edge;
+
+/*
+ * Jobs and the edges between them, rebuilt for every run. A finished job
+ * pushes the dependents it leaves with nothing to wait on to its own
+ * deque, so they tend to run on the worker whose output they read.
+ * Released changes whenever jobs become ready or the last one finishes,
+ * and is what idle workers wait on. ReleasedNS is when it last changed.
+ */
+typedef struct job_graph {
+    _Alignas(64) _Atomic int32_t Remaining;
+    _Alignas(64) _Atomic uint32_t Released;
+    _Atomic int64_t ReleasedNS;
+
+    _Alignas(64) int32_t JobCount;
+    int32_t EdgeCount;
+    graph_job Jobs[GRAPH_JOB_CAP];
+    graph_edge Edges[GRAPH_EDGE_CAP];
+    int32_t Dependents[GRAPH_EDGE_CAP];
+    _Atomic int32_t Waiting[GRAPH_JOB_CAP];
+} job_graph;
+
+/*
+ * A job as a worker ran it. JobI indexes the graph and Batch is the pool
+ * generation it ran in. WakeNS runs from the release that woke the worker
+ * to the job starting, and is -1 when the worker did not wait for the job.
+ */
+typedef struct job_span {
+    int64_t StartNS;
+    int64_t EndNS;
+    int32_t JobI;
+    int32_t WakeNS;
+    uint32_t Batch;
+} job_span;
+
+/*
+ * Ring of the last jobs a worker ran. Only that worker writes it, and
+ * others read it between batches. SpanCount counts every span ever
+ * written, so the newest is at SpanCount - 1.
+ */
+typedef struct worker_trace {
+    uint32_t SpanCount;
+    job_span Spans[WORKER_TRACE_CAP];
+} worker_trace;
+
+/*
+ * Of the last batch. BusyNS is the time each worker spent in jobs, and the
+ * wakes are those that ended in a job.
+ */
+typedef struct batch_usage {
+    int64_t BusyNS[WORKER_CAP];
+    int64_t WakeCount;
+    int64_t WakeSumNS;
+    int64_t WakeMaxNS;
+} batch_usage;
+
+/*Time a worker spent waiting, split by whether it had to park*/
+typedef struct worker_wait_stats {
+    int64_t SpinNS;
+    int64_t ParkNS;
+    int64_t SpinWakes;
+    int64_t ParkWakes;
+} worker_wait_stats;
+
+/*
+ * Wait stats as their worker keeps them. Only the worker writes, with
+ * Version odd while it does, so any thread can read a consistent copy.
+ * SpinStartNS and ParkStartNS are nonzero while that part of a wait is
+ * going on, so a reader can count the wait up to when it reads.
+ */
+typedef struct worker_wait_log {
+    _Atomic uint32_t Version;
+    _Atomic int64_t SpinNS;
+    _Atomic int64_t ParkNS;
+    _Atomic int64_t SpinWakes;
+    _Atomic int64_t ParkWakes;
+    _Atomic int64_t SpinStartNS;
+    _Atomic int64_t ParkStartNS;
+} worker_wait_log;
+
+/*
+ * Handles are opaque so the header stays free of platform types. Proc is
+ * the body of the worker's thread, and a worker without one only gets
+ * what it needs to park. CoreI is the core its thread is pinned to, or -1
+ * to leave it to the scheduler. The trace sits on lines of its own so
+ * recording it never touches another worker's cache lines.
+ */
 typedef struct worker {
-    HANDLE Thread; 
-    HANDLE StartEvent;
-    HANDLE EndEvent;
+    _Alignas(64) job_deque Deque;
+
+    _Alignas(64) void *Thread; 
+    void *Event;
+    _Atomic bool Parked;
+    worker_proc *Proc;
+    int32_t CoreI;
 
-    void (*Task)(void *);
-    LPVOID Data;
+    struct worker_pool *Pool;
+    int32_t WorkerI;
+    uint32_t Batch; /*Generation of the batch it runs*/
+    int64_t WokenNS; /*Release it last woke for, -1 once a job used it*/
+
+    _Alignas(64) worker_wait_log WaitLog;
+    _Alignas(64) worker_trace Trace;
 } worker;
 
-void CreateWorker(worker *Worker);
+/*
+ * Worker 0 is the thread that calls RunJobGraph. Workers wait for
+ * Generation to change to start a batch, and the caller waits for Pending
+ * to reach zero to end it. A batch runs Graph, and one without a Graph
+ * ends the threads.
+ */
+typedef struct worker_pool {
+    _Alignas(64) _Atomic uint32_t Generation;
+    _Alignas(64) _Atomic uint32_t Pending;
+
+    _Alignas(64) int32_t WorkerCount;
+    job_graph *Graph;
+    int64_t StartNS; /*Of the batch*/
+    worker Workers[WORKER_CAP];
+} worker_pool;
+
+/*
+ * A thread that runs one call at a time while the thread that started it
+ * goes on with other work. Started counts the calls handed over and
+ * Finished the calls done, and a start without a Call ends the thread.
+ * The call may run batches on a pool as its worker 0, as long as no other
+ * thread uses that pool until it is joined.
+ */
+typedef struct async_worker {
+    _Alignas(64) _Atomic uint32_t Started;
+    _Alignas(64) _Atomic uint32_t Finished;
+
+    _Alignas(64) worker_call *Call;
+    void *Data;
+    worker Owner; /*Parks the thread that joins*/
+    worker Thread;
+} async_worker;
+
+/*
+ * Workers whose threads fail to start are left out of the pool. Returns
+ * false only when not even worker 0 can be created.
+ */
+bool CreateWorkerPool(
+    worker_pool *Pool, 
+    int32_t WorkerCount, 
+    bool IsPinned
+);
+
+/*Stops the threads and waits for them to end*/
+void DestroyWorkerPool(worker_pool *Pool);
+
+void ResetJobGraph(job_graph *Graph);
+
+/*Returns the index of the first job, the others follow it*/
+int32_t AddGraphJobs(
+    job_graph *Graph, 
+    worker_task *Task, 
+    void *Data, 
+    int32_t JobCount
+);
+
+void AddGraphEdge(job_graph *Graph, int32_t From, int32_t To);
+
+/*Jobs must not wait on each other in a cycle*/
+void RunJobGraph(worker_pool *Pool, job_graph *Graph);
+
+/*
+ * These read the traces of the last batch the pool ran, so call them
+ * before it runs another
+ */
+
+/*From the first of Count jobs starting to the last finishing, 0 if none*/
+int64_t GetGraphJobsNS(
+    const worker_pool *Pool, 
+    int32_t FirstJobI, 
+    int32_t Count
+);
+
+/*The longest of Count jobs minus the shortest, 0 if none*/
+int64_t GetGraphJobSpreadNS(
+    const worker_pool *Pool, 
+    int32_t FirstJobI, 
+    int32_t Count
+);
+
+batch_usage GetBatchUsage(const worker_pool *Pool);
+
+/*
+ * Safe while the pool runs. Waits still going on count up to the call,
+ * so the difference of two sums is the waiting between them.
+ */
+worker_wait_stats SumWorkerWaitStats(const worker_pool *Pool);
+
+void RunWorker(worker *Worker);
+
+/*Returns false, with nothing left to destroy, if the thread cannot start*/
+bool CreateAsyncWorker(async_worker *Async);
+void DestroyAsyncWorker(async_worker *Async);
+
+/*The previous call must have been joined*/
+void StartAsyncCall(async_worker *Async, worker_call *Call, void *Data);
+
+/*Returns at once when every call started so far has finished*/
+void JoinAsyncCall(async_worker *Async);
+
+/*Backend*/
+int32_t GetHardwareThreadCount(void);
+
+/*
+ * Only workers with a Proc get a thread. Returns false, with nothing left
+ * to destroy, when the thread or what the worker parks on cannot be made.
+ */
+bool CreateWorker(worker *Worker);
+
+/*Waits for Proc to return, so the thread must have been told to stop*/
 void DestroyWorker(worker *Worker);
 
-DWORD WINAPI ThreadWorkerProc(LPVOID);
-void WorkerMultiWait(int WorkerCount, worker *Workers);
+/*Blocks while *Addr == Seen, though it may also return spuriously*/
+void ParkWorker(worker *Worker, _Atomic uint32_t *Addr, uint32_t Seen);
+void UnparkWorker(worker *Worker, _Atomic uint32_t *Addr);
+
+/*Unparks those of Workers parked on *Addr after it changed*/
+void UnparkWorkers(worker *Workers, int32_t Count, _Atomic uint32_t *Addr);
     
 #endif
@@ -0,0 +1,116 @@
+#define _GNU_SOURCE
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "scalar.h"
+#include "worker.h"
+
+/*
+ * Linux backend on pthreads. Workers park on a futex over the counter they
+ * wait on, so the kernel does the final comparison against Seen and no
+ * wake can be lost between the check and the sleep. Cores are counted
+ * among those the process may run on, so a restricted process still gets
+ * a pool its size and pins within its own set.
+ */
+
+static void *ThreadWorkerProc(void *VoidWorker) {
+    worker *Worker = VoidWorker;
+    Worker->Proc(Worker);
+    return NULL;
+}
+
+int32_t GetHardwareThreadCount(void) {
+    cpu_set_t Cpus;
+    if(sched_getaffinity(0, sizeof(Cpus), &Cpus) == 0) {
+        return MAX(CPU_COUNT(&Cpus), 1);
+    }
+    long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    return Count > 0 ? (int32_t) Count : 1;
+}
+
+/*Wraps CoreI around the cores the process may run on*/
+static bool GetCoreSet(int32_t CoreI, cpu_set_t *Core) {
+    cpu_set_t Cpus;
+    if(sched_getaffinity(0, sizeof(Cpus), &Cpus) != 0 || !CPU_COUNT(&Cpus)) {
+        return false;
+    }
+    int32_t Skip = CoreI % CPU_COUNT(&Cpus);
+    for(int32_t Cpu = 0; Cpu < CPU_SETSIZE; Cpu++) {
+        if(CPU_ISSET(Cpu, &Cpus) && Skip-- == 0) {
+            CPU_ZERO(Core);
+            CPU_SET(Cpu, Core);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ParkWorker(
+    [[maybe_unused]] worker *Worker, 
+    _Atomic uint32_t *Addr, 
+    uint32_t Seen
+) {
+    syscall(SYS_futex, (uint32_t *) Addr, FUTEX_WAIT_PRIVATE, Seen, NULL);
+}
+
+/*Only Worker waits on Addr, so one wake is enough*/
+void UnparkWorker(
+    [[maybe_unused]] worker *Worker, 
+    _Atomic uint32_t *Addr
+) {
+    syscall(SYS_futex, (uint32_t *) Addr, FUTEX_WAKE_PRIVATE, 1);
+}
+
+/*
+ * Waiters share the futex, so a single syscall wakes them all. Waking
+ * them one at a time could wake a worker that already saw the change and
+ * parked again, in place of one that did not.
+ */
+void UnparkWorkers(worker *Workers, int32_t Count, _Atomic uint32_t *Addr) {
+    for(int32_t I = 0; I < Count; I++) {
+        if(atomic_load(&Workers[I].Parked)) {
+            syscall(SYS_futex, (uint32_t *) Addr, FUTEX_WAKE_PRIVATE, INT_MAX);
+            return;
+        }
+    }
+}
+
+/*A core that cannot be looked up leaves the thread unpinned*/
+bool CreateWorker(worker *Worker) {
+    Worker->Event = NULL;
+    Worker->Thread = NULL;
+    if(!Worker->Proc) {
+        return true;
+    }
+
+    pthread_attr_t Attr;
+    if(pthread_attr_init(&Attr) != 0) {
+        return false;
+    }
+    cpu_set_t Core;
+    if(Worker->CoreI >= 0 && GetCoreSet(Worker->CoreI, &Core)) {
+        pthread_attr_setaffinity_np(&Attr, sizeof(Core), &Core);
+    }
+    pthread_t Thread;
+    bool IsCreated = (
+        pthread_create(&Thread, &Attr, ThreadWorkerProc, Worker) == 0
+    );
+    pthread_attr_destroy(&Attr);
+
+    if(IsCreated) {
+        Worker->Thread = (void *) (uintptr_t) Thread;
+    }
+    return IsCreated;
+}
+
+void DestroyWorker(worker *Worker) {
+    if(Worker->Thread) {
+        pthread_join((pthread_t) (uintptr_t) Worker->Thread, NULL);
+        Worker->Thread = NULL;
+    }
+}
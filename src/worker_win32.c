@@ -0,0 +1,112 @@
+#include <windows.h>
+#include <stdio.h>
+
+#include "worker.h"
+
+static DWORD WINAPI ThreadWorkerProc(LPVOID VoidWorker) {
+    worker *Worker = VoidWorker;
+    Worker->Proc(Worker);
+    return 0UL;
+}
+
+int32_t GetHardwareThreadCount(void) {
+    DWORD Count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    return Count > 0 ? (int32_t) Count : 1;
+}
+
+/*
+ * Each worker parks on its own auto-reset event. A wake that races the
+ * waiter's last check leaves the event set, which only costs one spurious
+ * return later.
+ */
+void ParkWorker(
+    worker *Worker, 
+    [[maybe_unused]] _Atomic uint32_t *Addr, 
+    [[maybe_unused]] uint32_t Seen
+) {
+    WaitForSingleObject(Worker->Event, INFINITE);
+}
+
+void UnparkWorker(worker *Worker, [[maybe_unused]] _Atomic uint32_t *Addr) {
+    SetEvent(Worker->Event);
+}
+
+void UnparkWorkers(worker *Workers, int32_t Count, _Atomic uint32_t *Addr) {
+    for(int32_t I = 0; I < Count; I++) {
+        if(atomic_load(&Workers[I].Parked)) {
+            UnparkWorker(&Workers[I], Addr);
+        }
+    }
+}
+
+/*
+ * Wraps CoreI around the cores in the process affinity mask, which only
+ * covers the process's own processor group. Zero when there is none.
+ */
+static DWORD_PTR GetCoreMask(int32_t CoreI) {
+    DWORD_PTR ProcessMask;
+    DWORD_PTR SystemMask;
+    bool HasMask = GetProcessAffinityMask(
+        GetCurrentProcess(), 
+        &ProcessMask, 
+        &SystemMask
+    );
+    if(!HasMask) {
+        return 0;
+    }
+    int32_t CoreCount = __builtin_popcountll(ProcessMask);
+    if(CoreCount == 0) {
+        return 0;
+    }
+    int32_t Skip = CoreI % CoreCount;
+    for(DWORD_PTR Mask = ProcessMask; Mask; Mask &= Mask - 1) {
+        if(Skip-- == 0) {
+            return Mask & -Mask;
+        }
+    }
+    return 0;
+}
+
+/*Threads start suspended so they are pinned before they run*/
+bool CreateWorker(worker *Worker) {
+    Worker->Thread = NULL;
+    Worker->Event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if(!Worker->Event) {
+        return false;
+    }
+    if(!Worker->Proc) {
+        return true;
+    }
+
+    Worker->Thread = CreateThread(
+        NULL, 
+        0, 
+        ThreadWorkerProc, 
+        Worker, 
+        CREATE_SUSPENDED, 
+        NULL
+    );
+    if(!Worker->Thread) {
+        CloseHandle(Worker->Event);
+        Worker->Event = NULL;
+        return false;
+    }
+    DWORD_PTR CoreMask = Worker->CoreI >= 0 ? GetCoreMask(Worker->CoreI) : 0;
+    if(CoreMask) {
+        SetThreadAffinityMask(Worker->Thread, CoreMask);
+    }
+    ResumeThread(Worker->Thread);
+    return true;
+}
+
+void DestroyWorker(worker *Worker) {
+    if(Worker->Thread) {
+        WaitForSingleObject(Worker->Thread, INFINITE);
+        CloseHandle(Worker->Thread);
+        Worker->Thread = NULL;
+    }
+    if(Worker->Event) {
+        CloseHandle(Worker->Event);
+        Worker->Event = NULL;
+    }
+}